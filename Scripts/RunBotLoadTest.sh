@@ -0,0 +1,61 @@
+#!/usr/bin/env bash
+# Runs the dedicated server against 8..128 headless bot clients and collects one load report per player count.
+#
+# Needs packaged Linux builds of the MovementPredictionServer and MovementPrediction targets.
+#   Scripts/RunBotLoadTest.sh <packaged build dir> [output dir] [seconds per run] [bot pattern]
+#
+# Extra server switches go in SERVER_ARGS, e.g. SERVER_ARGS="-MPRepGraph=0".
+# SERVER_PREFIX and CLIENT_PREFIX are put in front of the server and bot commands, e.g. SERVER_PREFIX="taskset -c 0-3".
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 <packaged build dir> [output dir] [seconds per run] [bot pattern]}
+OUT_DIR=${2:-LoadTest}
+RUN_SECONDS=${3:-60}
+PATTERN=${4:-Mixed}
+PLAYER_COUNTS=${PLAYER_COUNTS:-"8 16 32 64 128"}
+SERVER_ARGS=${SERVER_ARGS:-}
+SERVER_PREFIX=${SERVER_PREFIX:-}
+CLIENT_PREFIX=${CLIENT_PREFIX:-}
+MAP=/Game/FirstPersonCPP/Maps/FirstPersonExampleMap
+PORT=7777
+
+SERVER="$BUILD_DIR/LinuxServer/MovementPrediction/Binaries/Linux/MovementPredictionServer"
+CLIENT="$BUILD_DIR/LinuxNoEditor/MovementPrediction/Binaries/Linux/MovementPrediction"
+
+mkdir -p "$OUT_DIR"
+OUT_DIR=$(cd "$OUT_DIR" && pwd)
+
+for PLAYERS in $PLAYER_COUNTS; do
+	echo "== $PLAYERS players"
+	REPORT="$OUT_DIR/load_${PLAYERS}.csv"
+	PIDS=()
+
+	$SERVER_PREFIX "$SERVER" "$MAP?MaxPlayers=$PLAYERS" -port=$PORT -log -unattended $SERVER_ARGS \
+		-MPLoadReport="$REPORT" > "$OUT_DIR/server_${PLAYERS}.log" 2>&1 &
+	SERVER_PID=$!
+	sleep 10
+
+	for ((i = 0; i < PLAYERS; i++)); do
+		$CLIENT_PREFIX "$CLIENT" 127.0.0.1:$PORT -nullrhi -nosound -unattended -NoVerifyGC \
+			-MPBot=$PATTERN -MPBotSeed=$i > /dev/null 2>&1 &
+		PIDS+=($!)
+	done
+
+	sleep "$RUN_SECONDS"
+
+	kill "${PIDS[@]}" 2>/dev/null || true
+	kill "$SERVER_PID" 2>/dev/null || true
+	wait 2>/dev/null || true
+done
+
+# One summary row per player count, averaged over the steady-state rows (skips the first while bots connect)
+SUMMARY="$OUT_DIR/summary.csv"
+echo "Players,AvgTickMs,MaxTickMs,AvgInBytesPerSec,AvgOutBytesPerSec,CorrectionsPerSec" > "$SUMMARY"
+for PLAYERS in $PLAYER_COUNTS; do
+	awk -F, -v players="$PLAYERS" 'NR > 2 { n++; tick += $3; if ($4 > max) max = $4; in_bps += $5; out_bps += $6; corr += $8 }
+		END { if (n) printf "%d,%.3f,%.3f,%.0f,%.0f,%.2f\n", players, tick / n, max, in_bps / n, out_bps / n, corr / n }' \
+		"$OUT_DIR/load_${PLAYERS}.csv" >> "$SUMMARY"
+done
+
+cat "$SUMMARY"
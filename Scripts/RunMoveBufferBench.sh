@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+# Compares corrections with and without the server move buffer under emulated jitter, prediction on.
+#
+# Same builds as RunNetSoak.sh.
+#   Scripts/RunMoveBufferBench.sh <packaged build dir> [output dir] [seconds per cell] [bots per cell]
+#
+# Corrections avoided and the outgoing bandwidth saved are the buffer-off cell minus the buffer-on cell,
+# paid for with AvgMoveBufferMs of extra latency on every correction the client does get.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 <packaged build dir> [output dir] [seconds per cell] [bots per cell]}
+OUT_DIR=${2:-MoveBufferBench}
+CELL_SECONDS=${3:-45}
+BOTS=${4:-8}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+export RTTS=${RTTS:-"50 150"}
+export JITTERS=${JITTERS:-"0 10 30 60"}
+export LOSSES=${LOSSES:-"0"}
+export SCENARIOS=${SCENARIOS:-"Dash Strafe"}
+export PREDICTION=1
+
+mkdir -p "$OUT_DIR"
+OUT_DIR=$(cd "$OUT_DIR" && pwd)
+
+for BUFFER in 0 1; do
+	echo "=== mp.ServerMoveBuffer $BUFFER"
+	SERVER_ARGS="-MPServerMoveBuffer=$BUFFER" "$SCRIPT_DIR/RunNetSoak.sh" "$BUILD_DIR" "$OUT_DIR/buffer$BUFFER" "$CELL_SECONDS" "$BOTS"
+done
+
+RESULTS="$OUT_DIR/movebuffer.csv"
+echo "Scenario,RttMs,JitterMs,LossPct,CorrectionsPerSecPerPlayer,BufferedCorrectionsPerSecPerPlayer,CorrectionsAvoidedPerSecPerPlayer,OutBytesPerSecSaved,AvgMoveBufferMs,MoveBufferUnderrunsPerSecPerPlayer" > "$RESULTS"
+awk -F, 'FNR == 1 { next }
+	{ key = $1 "," $3 "," $4 "," $5 }
+	FILENAME ~ /buffer0/ { corr[key] = $6; out[key] = $9; next }
+	key in corr { printf "%s,%.3f,%.3f,%.3f,%.0f,%.2f,%.3f\n", key, corr[key], $6, corr[key] - $6, out[key] - $9, $10, $11 }' \
+	"$OUT_DIR/buffer0/soak.csv" "$OUT_DIR/buffer1/soak.csv" >> "$RESULTS"
+
+cat "$RESULTS"
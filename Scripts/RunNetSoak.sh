@@ -0,0 +1,80 @@
+#!/usr/bin/env bash
+# Runs the dash and strafe bot scenarios across a matrix of emulated latency, jitter and packet loss,
+# with movement prediction on and off, and writes one CSV row per cell.
+#
+# Needs packaged Linux Development builds (packet emulation is compiled out of Shipping).
+#   Scripts/RunNetSoak.sh <packaged build dir> [output dir] [seconds per cell] [bots per cell]
+#
+# Latency is round trip - each side delays its outgoing packets by half of it.
+# Override the matrix with RTTS, JITTERS, LOSSES, SCENARIOS and PREDICTION environment variables.
+# Extra server and client switches go in SERVER_ARGS and CLIENT_ARGS, e.g. SERVER_ARGS="-MPServerMoveBuffer=1".
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 <packaged build dir> [output dir] [seconds per cell] [bots per cell]}
+OUT_DIR=${2:-NetSoak}
+CELL_SECONDS=${3:-45}
+BOTS=${4:-8}
+RTTS=${RTTS:-"0 50 100 150 250"}
+JITTERS=${JITTERS:-"0 10 30"}
+LOSSES=${LOSSES:-"0 1 5"}
+SCENARIOS=${SCENARIOS:-"Dash Strafe"}
+PREDICTION=${PREDICTION:-"1 0"}
+SERVER_ARGS=${SERVER_ARGS:-}
+CLIENT_ARGS=${CLIENT_ARGS:-}
+MAP=/Game/FirstPersonCPP/Maps/FirstPersonExampleMap
+PORT=7777
+
+SERVER="$BUILD_DIR/LinuxServer/MovementPrediction/Binaries/Linux/MovementPredictionServer"
+CLIENT="$BUILD_DIR/LinuxNoEditor/MovementPrediction/Binaries/Linux/MovementPrediction"
+
+mkdir -p "$OUT_DIR"
+OUT_DIR=$(cd "$OUT_DIR" && pwd)
+
+RESULTS="$OUT_DIR/soak.csv"
+echo "Scenario,Prediction,RttMs,JitterMs,LossPct,CorrectionsPerSecPerPlayer,MeanPositionError,AvgInBytesPerSec,AvgOutBytesPerSec,AvgMoveBufferMs,MoveBufferUnderrunsPerSecPerPlayer,ClientReplayMsPerSecPerPlayer" > "$RESULTS"
+
+for SCENARIO in $SCENARIOS; do
+for PREDICT in $PREDICTION; do
+for RTT in $RTTS; do
+for JITTER in $JITTERS; do
+for LOSS in $LOSSES; do
+	CELL="${SCENARIO}_p${PREDICT}_rtt${RTT}_j${JITTER}_l${LOSS}"
+	echo "== $CELL"
+
+	NET_EMULATION="-PktLag=$((RTT / 2)) -PktLagVariance=$JITTER -PktLoss=$LOSS"
+	REPORT="$OUT_DIR/$CELL.csv"
+	PIDS=()
+
+	"$SERVER" "$MAP?MaxPlayers=$BOTS" -port=$PORT -log -unattended $NET_EMULATION $SERVER_ARGS \
+		-MPPrediction=$PREDICT -MPLoadReport="$REPORT" > "$OUT_DIR/$CELL.log" 2>&1 &
+	SERVER_PID=$!
+	sleep 10
+
+	for ((i = 0; i < BOTS; i++)); do
+		"$CLIENT" 127.0.0.1:$PORT -nullrhi -nosound -unattended -NoVerifyGC $NET_EMULATION $CLIENT_ARGS \
+			-MPPrediction=$PREDICT -MPBot=$SCENARIO -MPBotSeed=$i -abslog="$OUT_DIR/${CELL}_bot$i.log" > /dev/null 2>&1 &
+		PIDS+=($!)
+	done
+
+	sleep "$CELL_SECONDS"
+
+	kill "${PIDS[@]}" 2>/dev/null || true
+	kill "$SERVER_PID" 2>/dev/null || true
+	wait 2>/dev/null || true
+
+	# Bots log how long they spent replaying corrections when they shut down
+	REPLAY_MS=$(cat "$OUT_DIR/${CELL}"_bot*.log 2>/dev/null | sed -n 's/.*Saved moves:.* \([0-9.]*\) ms replaying.*/\1/p' |
+		awk -v bots="$BOTS" -v secs="$CELL_SECONDS" '{ ms += $1 } END { printf "%.3f", ms / bots / secs }') || REPLAY_MS=0
+
+	# Average the steady-state rows, the first one covers bots connecting
+	awk -F, -v cell="$SCENARIO,$PREDICT,$RTT,$JITTER,$LOSS" -v replay="$REPLAY_MS" 'NR > 2 && $2 > 0 { n++; corr += $8 / $2; err += $9; in_bps += $5; out_bps += $6; buf += $10; under += $11 / $2 }
+		END { if (n) printf "%s,%.3f,%.3f,%.0f,%.0f,%.2f,%.3f,%s\n", cell, corr / n, err / n, in_bps / n, out_bps / n, buf / n, under / n, replay }' \
+		"$REPORT" >> "$RESULTS"
+done
+done
+done
+done
+done
+
+cat "$RESULTS"
@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+# Compares the server with the replication graph against the engine's default replication path at 64 and 128 connections.
+#
+# Same builds as RunBotLoadTest.sh.
+#   Scripts/RunRepGraphBench.sh <packaged build dir> [output dir] [seconds per run] [bot pattern]
+#
+# Both paths run the same bots and the same movement, so the difference in server tick time is replication CPU.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 <packaged build dir> [output dir] [seconds per run] [bot pattern]}
+OUT_DIR=${2:-RepGraphBench}
+RUN_SECONDS=${3:-90}
+PATTERN=${4:-Mixed}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+export PLAYER_COUNTS=${PLAYER_COUNTS:-"64 128"}
+
+mkdir -p "$OUT_DIR"
+OUT_DIR=$(cd "$OUT_DIR" && pwd)
+
+for REPGRAPH in 0 1; do
+	echo "=== mp.ReplicationGraph $REPGRAPH"
+	SERVER_ARGS="-MPRepGraph=$REPGRAPH" "$SCRIPT_DIR/RunBotLoadTest.sh" "$BUILD_DIR" "$OUT_DIR/repgraph$REPGRAPH" "$RUN_SECONDS" "$PATTERN"
+done
+
+RESULTS="$OUT_DIR/repgraph.csv"
+echo "Players,DefaultTickMs,RepGraphTickMs,TickMsSaved,DefaultOutBytesPerSec,RepGraphOutBytesPerSec" > "$RESULTS"
+join -t, <(tail -n +2 "$OUT_DIR/repgraph0/summary.csv" | sort -t, -k1,1) <(tail -n +2 "$OUT_DIR/repgraph1/summary.csv" | sort -t, -k1,1) |
+	awk -F, '{ printf "%d,%.3f,%.3f,%.3f,%.0f,%.0f\n", $1, $2, $7, $2 - $7, $5, $10 }' | sort -t, -n -k1,1 >> "$RESULTS"
+
+cat "$RESULTS"
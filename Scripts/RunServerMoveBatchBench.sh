@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+# Measures how server tick time scales with cores, with ServerMoves processed as they arrive and in the server move batch.
+#
+# Same builds as RunBotLoadTest.sh, on a Linux machine with enough cores for the server and the bots.
+#   Scripts/RunServerMoveBatchBench.sh <packaged build dir> [output dir] [seconds per run] [players]
+#
+# The server is pinned to the first 1, 2, 4... cores up to MAX_CORES (half the machine by default) with taskset,
+# the bots always get the cores after MAX_CORES so they cost the server the same in every run.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 <packaged build dir> [output dir] [seconds per run] [players]}
+OUT_DIR=${2:-ServerMoveBatchBench}
+RUN_SECONDS=${3:-60}
+PLAYERS=${4:-64}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+TOTAL_CORES=$(nproc)
+MAX_CORES=${MAX_CORES:-$((TOTAL_CORES / 2))}
+
+if [ "$MAX_CORES" -lt 1 ] || [ "$MAX_CORES" -ge "$TOTAL_CORES" ]; then
+	echo "MAX_CORES must leave at least one of the $TOTAL_CORES cores for the bots"
+	exit 1
+fi
+
+CORE_COUNTS=${CORE_COUNTS:-}
+if [ -z "$CORE_COUNTS" ]; then
+	for ((CORES = 1; CORES < MAX_CORES; CORES *= 2)); do
+		CORE_COUNTS="$CORE_COUNTS $CORES"
+	done
+	CORE_COUNTS="$CORE_COUNTS $MAX_CORES"
+fi
+
+mkdir -p "$OUT_DIR"
+OUT_DIR=$(cd "$OUT_DIR" && pwd)
+
+export PLAYER_COUNTS=$PLAYERS
+export CLIENT_PREFIX="taskset -c $MAX_CORES-$((TOTAL_CORES - 1))"
+
+for CORES in $CORE_COUNTS; do
+	for BATCH in 0 1; do
+		echo "=== $CORES cores, mp.BatchServerMoves $BATCH"
+		SERVER_PREFIX="taskset -c 0-$((CORES - 1))" SERVER_ARGS="-MPBatchServerMoves=$BATCH" \
+			"$SCRIPT_DIR/RunBotLoadTest.sh" "$BUILD_DIR" "$OUT_DIR/cores${CORES}_batch$BATCH" "$RUN_SECONDS"
+	done
+done
+
+# Speedup is tick time as the moves arrive over tick time batched, at the same core count
+RESULTS="$OUT_DIR/serverbatch.csv"
+echo "Cores,Players,AvgTickMs,BatchedAvgTickMs,BatchedMaxTickMs,Speedup" > "$RESULTS"
+for CORES in $CORE_COUNTS; do
+	awk -F, -v cores="$CORES" 'FNR == 1 { next }
+		FILENAME ~ /batch0/ { players = $1; tick = $2; next }
+		{ printf "%d,%d,%.3f,%.3f,%.3f,%.2f\n", cores, players, tick, $2, $3, $2 > 0 ? tick / $2 : 0 }' \
+		"$OUT_DIR/cores${CORES}_batch0/summary.csv" "$OUT_DIR/cores${CORES}_batch1/summary.csv" >> "$RESULTS"
+done
+
+cat "$RESULTS"
@@ -0,0 +1,79 @@
+#!/usr/bin/env bash
+# Measures game thread time on a rendering client watching 64 bots, with significance-based tick throttling off and on.
+#
+# Same builds as RunBotLoadTest.sh, run on a machine with a GPU for the observer.
+#   Scripts/RunSignificanceBench.sh <packaged build dir> [output dir] [seconds per run] [bots]
+#
+# The observer is a plain player standing at a spawn point, it captures a CSV profile for the whole run.
+# The first WARMUP_FRAMES frames (bots connecting, shaders compiling) are left out of the averages.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 <packaged build dir> [output dir] [seconds per run] [bots]}
+OUT_DIR=${2:-SignificanceBench}
+RUN_SECONDS=${3:-60}
+BOTS=${4:-64}
+PATTERN=${PATTERN:-Mixed}
+WARMUP_FRAMES=${WARMUP_FRAMES:-600}
+MAP=/Game/FirstPersonCPP/Maps/FirstPersonExampleMap
+PORT=7777
+
+SERVER="$BUILD_DIR/LinuxServer/MovementPrediction/Binaries/Linux/MovementPredictionServer"
+CLIENT="$BUILD_DIR/LinuxNoEditor/MovementPrediction/Binaries/Linux/MovementPrediction"
+CSV_DIR="$BUILD_DIR/LinuxNoEditor/MovementPrediction/Saved/Profiling/CSV"
+
+mkdir -p "$OUT_DIR"
+OUT_DIR=$(cd "$OUT_DIR" && pwd)
+
+RESULTS="$OUT_DIR/significance.csv"
+echo "Significance,Bots,AvgGameThreadMs,AvgFrameMs,AvgCharactersThrottled" > "$RESULTS"
+
+for SIGNIFICANCE in 0 1; do
+	echo "== mp.Significance $SIGNIFICANCE"
+	PIDS=()
+
+	"$SERVER" "$MAP?MaxPlayers=$((BOTS + 1))" -port=$PORT -log -unattended > "$OUT_DIR/server_$SIGNIFICANCE.log" 2>&1 &
+	SERVER_PID=$!
+	sleep 10
+
+	for ((i = 0; i < BOTS; i++)); do
+		"$CLIENT" 127.0.0.1:$PORT -nullrhi -nosound -unattended -NoVerifyGC \
+			-MPBot=$PATTERN -MPBotSeed=$i > /dev/null 2>&1 &
+		PIDS+=($!)
+	done
+	sleep 10
+
+	# Rendering, so the bots are actually drawn
+	rm -f "$CSV_DIR"/*.csv
+	"$CLIENT" 127.0.0.1:$PORT -windowed -ResX=1280 -ResY=720 -nosound -unattended -NoVerifyGC \
+		-MPSignificance=$SIGNIFICANCE -csvCaptureFrames=1000000 -abslog="$OUT_DIR/observer_$SIGNIFICANCE.log" > /dev/null 2>&1 &
+	OBSERVER_PID=$!
+
+	sleep "$RUN_SECONDS"
+
+	# The CSV is only written when the capture ends, so let the observer shut down cleanly first
+	kill "$OBSERVER_PID" 2>/dev/null || true
+	wait "$OBSERVER_PID" 2>/dev/null || true
+	kill "${PIDS[@]}" 2>/dev/null || true
+	kill "$SERVER_PID" 2>/dev/null || true
+	wait 2>/dev/null || true
+
+	PROFILE=$(ls -t "$CSV_DIR"/*.csv 2>/dev/null | head -n 1 || true)
+	if [ -z "$PROFILE" ]; then
+		echo "No CSV profile from the observer, see $OUT_DIR/observer_$SIGNIFICANCE.log"
+		continue
+	fi
+	cp "$PROFILE" "$OUT_DIR/observer_$SIGNIFICANCE.csv"
+
+	# Columns by name, data rows are the ones starting with a number
+	awk -F, -v sig="$SIGNIFICANCE" -v bots="$BOTS" -v warmup="$WARMUP_FRAMES" '
+		NR == 1 { for (i = 1; i <= NF; i++) { col[$i] = i } next }
+		$1 !~ /^[0-9.]+$/ { next }
+		++frame > warmup { n++; gt += $col["GameThreadTime"]; ft += $col["FrameTime"]; thr += $col["MovementPrediction/CharactersThrottled"] }
+		END { if (n) printf "%d,%d,%.3f,%.3f,%.1f\n", sig, bots, gt / n, ft / n, thr / n }' \
+		"$OUT_DIR/observer_$SIGNIFICANCE.csv" >> "$RESULTS"
+done
+
+# Game thread ms saved is the first row minus the second
+cat "$RESULTS"
+awk -F, 'NR == 2 { off = $3 } NR == 3 { printf "Game thread ms saved: %.3f\n", off - $3 }' "$RESULTS"
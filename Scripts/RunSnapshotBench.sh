@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+# Compares snapshot interpolation against each character replicating its own movement, at 64 connections by default.
+#
+# Same builds as RunBotLoadTest.sh.
+#   Scripts/RunSnapshotBench.sh <packaged build dir> [output dir] [seconds per run] [bot pattern]
+#
+# Both modes run the same bots and the same movement, so the differences in server tick time and outgoing bytes are
+# the replication path. Client interpolation cost shows up as "Snapshot Interpolation" in stat MovementPrediction.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 <packaged build dir> [output dir] [seconds per run] [bot pattern]}
+OUT_DIR=${2:-SnapshotBench}
+RUN_SECONDS=${3:-90}
+PATTERN=${4:-Mixed}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+export PLAYER_COUNTS=${PLAYER_COUNTS:-"64"}
+
+mkdir -p "$OUT_DIR"
+OUT_DIR=$(cd "$OUT_DIR" && pwd)
+
+for SNAPSHOTS in 0 1; do
+	echo "=== mp.Snapshots $SNAPSHOTS"
+	SERVER_ARGS="-MPSnapshots=$SNAPSHOTS" "$SCRIPT_DIR/RunBotLoadTest.sh" "$BUILD_DIR" "$OUT_DIR/snapshots$SNAPSHOTS" "$RUN_SECONDS" "$PATTERN"
+done
+
+RESULTS="$OUT_DIR/snapshots.csv"
+echo "Players,ReplicatedTickMs,SnapshotTickMs,ReplicatedOutBytesPerSec,SnapshotOutBytesPerSec,OutBytesSaved" > "$RESULTS"
+join -t, <(tail -n +2 "$OUT_DIR/snapshots0/summary.csv" | sort -t, -k1,1) <(tail -n +2 "$OUT_DIR/snapshots1/summary.csv" | sort -t, -k1,1) |
+	awk -F, '{ printf "%d,%.3f,%.3f,%.0f,%.0f,%.0f\n", $1, $2, $7, $5, $10, $5 - $10 }' | sort -t, -n -k1,1 >> "$RESULTS"
+
+cat "$RESULTS"
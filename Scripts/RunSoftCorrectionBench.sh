@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+# Compares corrections sent and client replay time with mp.SoftCorrections off and on, prediction on.
+#
+# Same builds as RunNetSoak.sh.
+#   Scripts/RunSoftCorrectionBench.sh <packaged build dir> [output dir] [seconds per cell] [bots per cell]
+#
+# The server gets the dash tolerances and the bots get error blending in the same run, both from -MPSoftCorrections.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 <packaged build dir> [output dir] [seconds per cell] [bots per cell]}
+OUT_DIR=${2:-SoftCorrectionBench}
+CELL_SECONDS=${3:-45}
+BOTS=${4:-8}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+export RTTS=${RTTS:-"50 150"}
+export JITTERS=${JITTERS:-"0 30"}
+export LOSSES=${LOSSES:-"0 1"}
+export SCENARIOS=${SCENARIOS:-"Dash Strafe"}
+export PREDICTION=1
+
+mkdir -p "$OUT_DIR"
+OUT_DIR=$(cd "$OUT_DIR" && pwd)
+
+for SOFT in 0 1; do
+	echo "=== mp.SoftCorrections $SOFT"
+	SERVER_ARGS="-MPSoftCorrections=$SOFT" CLIENT_ARGS="-MPSoftCorrections=$SOFT" \
+		"$SCRIPT_DIR/RunNetSoak.sh" "$BUILD_DIR" "$OUT_DIR/soft$SOFT" "$CELL_SECONDS" "$BOTS"
+done
+
+RESULTS="$OUT_DIR/softcorrections.csv"
+echo "Scenario,RttMs,JitterMs,LossPct,CorrectionsPerSecPerPlayer,SoftCorrectionsPerSecPerPlayer,ClientReplayMsPerSec,SoftClientReplayMsPerSec,MeanPositionError,SoftMeanPositionError" > "$RESULTS"
+awk -F, 'FNR == 1 { next }
+	{ key = $1 "," $3 "," $4 "," $5 }
+	FILENAME ~ /soft0/ { corr[key] = $6; replay[key] = $12; err[key] = $7; next }
+	key in corr { printf "%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", key, corr[key], $6, replay[key], $12, err[key], $7 }' \
+	"$OUT_DIR/soft0/soak.csv" "$OUT_DIR/soft1/soak.csv" >> "$RESULTS"
+
+cat "$RESULTS"
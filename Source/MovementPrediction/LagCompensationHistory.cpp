@@ -0,0 +1,322 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationHistory.h"
+
+namespace LagCompensation
+{
+	/** Earliest point in [0, 1] where Start + Delta * T comes within Radius of Center, false if it never does */
+	bool IntersectSphere(const FVector& Start, const FVector& Delta, const FVector& Center, float Radius, float& OutT)
+	{
+		const FVector ToStart = Start - Center;
+		const float C = ToStart.SizeSquared() - FMath::Square(Radius);
+		if (C <= 0.f)
+		{
+			OutT = 0.f;
+			return true;
+		}
+
+		const float A = Delta.SizeSquared();
+		const float B = ToStart | Delta;
+		const float Discriminant = FMath::Square(B) - A * C;
+		if (A <= SMALL_NUMBER || B >= 0.f || Discriminant < 0.f)
+		{
+			return false;
+		}
+
+		OutT = (-B - FMath::Sqrt(Discriminant)) / A;
+		return OutT <= 1.f;
+	}
+
+	/** Same for an upright capsule, CylinderHalfHeight is half the height of its straight part */
+	bool IntersectCapsule(const FVector& Start, const FVector& Delta, const FVector& Center, float CylinderHalfHeight, float Radius, float& OutT)
+	{
+		const float BottomZ = Center.Z - CylinderHalfHeight;
+		const float TopZ = Center.Z + CylinderHalfHeight;
+
+		// The straight part, as a circle in XY
+		const float DX = Start.X - Center.X;
+		const float DY = Start.Y - Center.Y;
+		const float C = FMath::Square(DX) + FMath::Square(DY) - FMath::Square(Radius);
+		if (C <= 0.f && Start.Z >= BottomZ && Start.Z <= TopZ)
+		{
+			OutT = 0.f;
+			return true;
+		}
+
+		bool bHit = false;
+		OutT = 1.f;
+
+		const float A = FMath::Square(Delta.X) + FMath::Square(Delta.Y);
+		if (A > SMALL_NUMBER)
+		{
+			const float B = DX * Delta.X + DY * Delta.Y;
+			const float Discriminant = FMath::Square(B) - A * C;
+			if (Discriminant >= 0.f)
+			{
+				const float T = (-B - FMath::Sqrt(Discriminant)) / A;
+				const float Z = Start.Z + Delta.Z * T;
+				if (T >= 0.f && T <= 1.f && Z >= BottomZ && Z <= TopZ)
+				{
+					OutT = T;
+					bHit = true;
+				}
+			}
+		}
+
+		// The round ends
+		float SphereT;
+		if (IntersectSphere(Start, Delta, FVector(Center.X, Center.Y, BottomZ), Radius, SphereT) && SphereT < OutT)
+		{
+			OutT = SphereT;
+			bHit = true;
+		}
+		if (IntersectSphere(Start, Delta, FVector(Center.X, Center.Y, TopZ), Radius, SphereT) && SphereT < OutT)
+		{
+			OutT = SphereT;
+			bHit = true;
+		}
+
+		return bHit;
+	}
+}
+
+FLagCompensationHistory::FLagCompensationHistory(int32 InNumFrames, int32 InSlotCapacity)
+	: NumFrames(FMath::Max(InNumFrames, 2))
+	, SlotCapacity(0)
+	, NumRecordedFrames(0)
+	, NewestRow(NumFrames - 1)
+{
+	FrameTimes.SetNumZeroed(NumFrames);
+	GrowSlots(FMath::Max(InSlotCapacity, 1));
+}
+
+void FLagCompensationHistory::GrowSlots(int32 NewSlotCapacity)
+{
+	TArray<float> OldPosX = MoveTemp(PosX);
+	TArray<float> OldPosY = MoveTemp(PosY);
+	TArray<float> OldPosZ = MoveTemp(PosZ);
+	TArray<uint8> OldHasSample = MoveTemp(HasSample);
+
+	PosX.SetNumZeroed(NumFrames * NewSlotCapacity);
+	PosY.SetNumZeroed(NumFrames * NewSlotCapacity);
+	PosZ.SetNumZeroed(NumFrames * NewSlotCapacity);
+	HasSample.SetNumZeroed(NumFrames * NewSlotCapacity);
+
+	for (int32 Row = 0; Row < NumFrames && SlotCapacity > 0; ++Row)
+	{
+		FMemory::Memcpy(&PosX[Row * NewSlotCapacity], &OldPosX[Row * SlotCapacity], SlotCapacity * sizeof(float));
+		FMemory::Memcpy(&PosY[Row * NewSlotCapacity], &OldPosY[Row * SlotCapacity], SlotCapacity * sizeof(float));
+		FMemory::Memcpy(&PosZ[Row * NewSlotCapacity], &OldPosZ[Row * SlotCapacity], SlotCapacity * sizeof(float));
+		FMemory::Memcpy(&HasSample[Row * NewSlotCapacity], &OldHasSample[Row * SlotCapacity], SlotCapacity * sizeof(uint8));
+	}
+
+	Radii.SetNumZeroed(NewSlotCapacity);
+	HalfHeights.SetNumZeroed(NewSlotCapacity);
+	SlotInUse.SetNumZeroed(NewSlotCapacity);
+	RewoundX.SetNumZeroed(NewSlotCapacity);
+	RewoundY.SetNumZeroed(NewSlotCapacity);
+	RewoundZ.SetNumZeroed(NewSlotCapacity);
+	RewoundValid.SetNumZeroed(NewSlotCapacity);
+
+	SlotCapacity = NewSlotCapacity;
+}
+
+int32 FLagCompensationHistory::AddSlot(float Radius, float HalfHeight)
+{
+	int32 Slot = SlotInUse.IndexOfByKey(0);
+	if (Slot == INDEX_NONE)
+	{
+		Slot = SlotCapacity;
+		GrowSlots(SlotCapacity * 2);
+	}
+
+	SlotInUse[Slot] = 1;
+	Radii[Slot] = Radius;
+	HalfHeights[Slot] = HalfHeight;
+
+	// Whoever had the slot before doesn't get interpolated into the new capsule
+	for (int32 Row = 0; Row < NumFrames; ++Row)
+	{
+		HasSample[Row * SlotCapacity + Slot] = 0;
+	}
+
+	return Slot;
+}
+
+void FLagCompensationHistory::RemoveSlot(int32 Slot)
+{
+	if (SlotInUse.IsValidIndex(Slot))
+	{
+		SlotInUse[Slot] = 0;
+	}
+}
+
+void FLagCompensationHistory::BeginFrame(float Time)
+{
+	NewestRow = (NewestRow + 1) % NumFrames;
+	NumRecordedFrames = FMath::Min(NumRecordedFrames + 1, NumFrames);
+	FrameTimes[NewestRow] = Time;
+	FMemory::Memzero(&HasSample[NewestRow * SlotCapacity], SlotCapacity * sizeof(uint8));
+}
+
+void FLagCompensationHistory::SetSlotLocation(int32 Slot, const FVector& Location)
+{
+	const int32 Index = NewestRow * SlotCapacity + Slot;
+	PosX[Index] = Location.X;
+	PosY[Index] = Location.Y;
+	PosZ[Index] = Location.Z;
+	HasSample[Index] = 1;
+}
+
+int32 FLagCompensationHistory::GetRow(int32 LogicalIndex) const
+{
+	return (NewestRow - (NumRecordedFrames - 1) + LogicalIndex + NumFrames) % NumFrames;
+}
+
+float FLagCompensationHistory::GetOldestTime() const
+{
+	return NumRecordedFrames > 0 ? FrameTimes[GetRow(0)] : 0.f;
+}
+
+float FLagCompensationHistory::GetNewestTime() const
+{
+	return NumRecordedFrames > 0 ? FrameTimes[NewestRow] : 0.f;
+}
+
+bool FLagCompensationHistory::FindRows(float Time, int32& OutOlderRow, int32& OutNewerRow, float& OutAlpha) const
+{
+	if (NumRecordedFrames == 0)
+	{
+		return false;
+	}
+
+	if (Time <= GetOldestTime() || NumRecordedFrames == 1)
+	{
+		OutOlderRow = OutNewerRow = GetRow(0);
+		OutAlpha = 0.f;
+		return true;
+	}
+
+	if (Time >= GetNewestTime())
+	{
+		OutOlderRow = OutNewerRow = NewestRow;
+		OutAlpha = 0.f;
+		return true;
+	}
+
+	// Newest frame at or before Time
+	int32 Low = 0;
+	int32 High = NumRecordedFrames - 1;
+	while (High - Low > 1)
+	{
+		const int32 Mid = (Low + High) / 2;
+		if (FrameTimes[GetRow(Mid)] <= Time)
+		{
+			Low = Mid;
+		}
+		else
+		{
+			High = Mid;
+		}
+	}
+
+	OutOlderRow = GetRow(Low);
+	OutNewerRow = GetRow(High);
+	const float FrameSpan = FrameTimes[OutNewerRow] - FrameTimes[OutOlderRow];
+	OutAlpha = FrameSpan > SMALL_NUMBER ? (Time - FrameTimes[OutOlderRow]) / FrameSpan : 0.f;
+	return true;
+}
+
+bool FLagCompensationHistory::GetLocationAt(int32 Slot, float Time, FVector& OutLocation) const
+{
+	int32 OlderRow, NewerRow;
+	float Alpha;
+	if (!SlotInUse.IsValidIndex(Slot) || !SlotInUse[Slot] || !FindRows(Time, OlderRow, NewerRow, Alpha))
+	{
+		return false;
+	}
+
+	const int32 Older = OlderRow * SlotCapacity + Slot;
+	const int32 Newer = NewerRow * SlotCapacity + Slot;
+	if (!HasSample[Older] && !HasSample[Newer])
+	{
+		return false;
+	}
+
+	// Only one side, e.g. the frame it was registered or went away in
+	const int32 From = HasSample[Older] ? Older : Newer;
+	const int32 To = HasSample[Newer] ? Newer : Older;
+	OutLocation = FMath::Lerp(FVector(PosX[From], PosY[From], PosZ[From]), FVector(PosX[To], PosY[To], PosZ[To]), Alpha);
+	return true;
+}
+
+bool FLagCompensationHistory::SweepAt(float Time, const FVector& Start, const FVector& End, float SweepRadius, FLagCompensationHit& OutHit, int32 IgnoreSlot) const
+{
+	int32 OlderRow, NewerRow;
+	float Alpha;
+	if (!FindRows(Time, OlderRow, NewerRow, Alpha))
+	{
+		return false;
+	}
+
+	// Rewind every slot in one pass over both rows
+	const int32 OlderBase = OlderRow * SlotCapacity;
+	const int32 NewerBase = NewerRow * SlotCapacity;
+	for (int32 Slot = 0; Slot < SlotCapacity; ++Slot)
+	{
+		const int32 Older = HasSample[OlderBase + Slot] ? OlderBase + Slot : NewerBase + Slot;
+		const int32 Newer = HasSample[NewerBase + Slot] ? NewerBase + Slot : OlderBase + Slot;
+		RewoundX[Slot] = PosX[Older] + (PosX[Newer] - PosX[Older]) * Alpha;
+		RewoundY[Slot] = PosY[Older] + (PosY[Newer] - PosY[Older]) * Alpha;
+		RewoundZ[Slot] = PosZ[Older] + (PosZ[Newer] - PosZ[Older]) * Alpha;
+		RewoundValid[Slot] = SlotInUse[Slot] & (HasSample[OlderBase + Slot] | HasSample[NewerBase + Slot]);
+	}
+
+	const FVector Delta = End - Start;
+	const FVector SweepMin = Start.ComponentMin(End) - FVector(SweepRadius);
+	const FVector SweepMax = Start.ComponentMax(End) + FVector(SweepRadius);
+
+	bool bHit = false;
+	OutHit = FLagCompensationHit();
+	for (int32 Slot = 0; Slot < SlotCapacity; ++Slot)
+	{
+		if (!RewoundValid[Slot] || Slot == IgnoreSlot)
+		{
+			continue;
+		}
+
+		// Bounds first, most capsules are nowhere near the shot
+		const float Radius = Radii[Slot];
+		const float HalfHeight = HalfHeights[Slot];
+		if (RewoundX[Slot] + Radius < SweepMin.X || RewoundX[Slot] - Radius > SweepMax.X ||
+			RewoundY[Slot] + Radius < SweepMin.Y || RewoundY[Slot] - Radius > SweepMax.Y ||
+			RewoundZ[Slot] + HalfHeight < SweepMin.Z || RewoundZ[Slot] - HalfHeight > SweepMax.Z)
+		{
+			continue;
+		}
+
+		const FVector Center(RewoundX[Slot], RewoundY[Slot], RewoundZ[Slot]);
+		const float CylinderHalfHeight = FMath::Max(HalfHeight - Radius, 0.f);
+		float T;
+		if (LagCompensation::IntersectCapsule(Start, Delta, Center, CylinderHalfHeight, Radius + SweepRadius, T) && T < OutHit.Time)
+		{
+			bHit = true;
+			OutHit.Slot = Slot;
+			OutHit.Time = T;
+			OutHit.Location = Start + Delta * T;
+
+			const FVector AxisPoint(Center.X, Center.Y, FMath::Clamp(OutHit.Location.Z, Center.Z - CylinderHalfHeight, Center.Z + CylinderHalfHeight));
+			OutHit.Normal = (OutHit.Location - AxisPoint).GetSafeNormal();
+		}
+	}
+
+	return bHit;
+}
+
+SIZE_T FLagCompensationHistory::GetAllocatedSize() const
+{
+	return FrameTimes.GetAllocatedSize() + PosX.GetAllocatedSize() + PosY.GetAllocatedSize() + PosZ.GetAllocatedSize() + HasSample.GetAllocatedSize()
+		+ Radii.GetAllocatedSize() + HalfHeights.GetAllocatedSize() + SlotInUse.GetAllocatedSize()
+		+ RewoundX.GetAllocatedSize() + RewoundY.GetAllocatedSize() + RewoundZ.GetAllocatedSize() + RewoundValid.GetAllocatedSize();
+}
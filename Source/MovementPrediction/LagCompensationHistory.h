@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Where a rewound sweep first touched a capsule */
+struct FLagCompensationHit
+{
+	/** Slot of the capsule that was hit */
+	int32 Slot = INDEX_NONE;
+
+	/** 0 at the start of the sweep, 1 at the end */
+	float Time = 1.f;
+
+	/** Center of the sweep where it touched */
+	FVector Location = FVector::ZeroVector;
+
+	FVector Normal = FVector::UpVector;
+};
+
+/**
+ * Ring buffer of upright capsule locations, one row per recorded frame.
+ *
+ * Each row holds every slot's location side by side in separate X/Y/Z arrays, so recording a frame and rewinding
+ * every capsule to a point in time both walk memory in order. Capsules never rotate, only their location is kept.
+ */
+class FLagCompensationHistory
+{
+public:
+	FLagCompensationHistory(int32 InNumFrames, int32 InSlotCapacity);
+
+	/** Takes a free slot for a capsule, its history starts empty */
+	int32 AddSlot(float Radius, float HalfHeight);
+
+	void RemoveSlot(int32 Slot);
+
+	/** Starts a new row at Time, overwriting the oldest. Slots not given a location this frame have no sample in it. */
+	void BeginFrame(float Time);
+
+	/** Records Slot's location in the current row */
+	void SetSlotLocation(int32 Slot, const FVector& Location);
+
+	/** Slot's location at Time, interpolated between the rows around it */
+	bool GetLocationAt(int32 Slot, float Time, FVector& OutLocation) const;
+
+	/**
+	 * Sweeps a sphere of SweepRadius (0 for a line) from Start to End against every capsule as it was at Time, without touching the live ones.
+	 * Times outside the history are clamped to it. Returns the nearest hit.
+	 */
+	bool SweepAt(float Time, const FVector& Start, const FVector& End, float SweepRadius, FLagCompensationHit& OutHit, int32 IgnoreSlot = INDEX_NONE) const;
+
+	float GetOldestTime() const;
+	float GetNewestTime() const;
+
+	int32 GetNumRecordedFrames() const { return NumRecordedFrames; }
+
+	/** Bytes held by the history */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/** The rows either side of Time and how far between them it is */
+	bool FindRows(float Time, int32& OutOlderRow, int32& OutNewerRow, float& OutAlpha) const;
+
+	/** Row LogicalIndex frames after the oldest */
+	int32 GetRow(int32 LogicalIndex) const;
+
+	/** Makes room for more slots, keeps the recorded history */
+	void GrowSlots(int32 NewSlotCapacity);
+
+	int32 NumFrames;
+	int32 SlotCapacity;
+	int32 NumRecordedFrames;
+	int32 NewestRow;
+
+	/** Time of each row */
+	TArray<float> FrameTimes;
+
+	// Row * SlotCapacity + Slot
+	TArray<float> PosX;
+	TArray<float> PosY;
+	TArray<float> PosZ;
+	TArray<uint8> HasSample;
+
+	// Per slot
+	TArray<float> Radii;
+	TArray<float> HalfHeights;
+	TArray<uint8> SlotInUse;
+
+	// Every slot rewound to the time of the last sweep, reused between sweeps
+	mutable TArray<float> RewoundX;
+	mutable TArray<float> RewoundY;
+	mutable TArray<float> RewoundZ;
+	mutable TArray<uint8> RewoundValid;
+};
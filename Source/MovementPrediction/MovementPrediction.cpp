@@ -1,7 +1,57 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "MovementPrediction.h"
+#include "MovementPredictionReplicationGraph.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/LowLevelMemStats.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, MovementPrediction, "MovementPrediction" );
+CSV_DEFINE_CATEGORY_MODULE(MOVEMENTPREDICTION_API, MovementPrediction, true);
+
+DECLARE_LLM_MEMORY_STAT(TEXT("MovementPrediction"), STAT_MovementPredictionSummaryLLM, STATGROUP_LLM);
+DECLARE_LLM_MEMORY_STAT(TEXT("Saved Moves"), STAT_SavedMovesLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Prediction Data"), STAT_PredictionDataLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Projectiles"), STAT_ProjectilesLLM, STATGROUP_LLMFULL);
+
+class FMovementPredictionModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		FLowLevelMemTracker& LLM = FLowLevelMemTracker::Get();
+		LLM.RegisterProjectTag((int32)EMovementPredictionLLMTag::SavedMoves, TEXT("SavedMoves"), GET_STATFNAME(STAT_SavedMovesLLM), GET_STATFNAME(STAT_MovementPredictionSummaryLLM));
+		LLM.RegisterProjectTag((int32)EMovementPredictionLLMTag::PredictionData, TEXT("PredictionData"), GET_STATFNAME(STAT_PredictionDataLLM), GET_STATFNAME(STAT_MovementPredictionSummaryLLM));
+		LLM.RegisterProjectTag((int32)EMovementPredictionLLMTag::Projectiles, TEXT("Projectiles"), GET_STATFNAME(STAT_ProjectilesLLM), GET_STATFNAME(STAT_MovementPredictionSummaryLLM));
+#endif
+
+		UMovementPredictionReplicationGraph::RegisterReplicationDriver();
+
+		// Load tests and soaks switch these per run
+		static const TCHAR* const CommandLineCVars[][2] =
+		{
+			{ TEXT("MPServerMoveBuffer="), TEXT("mp.ServerMoveBuffer") },
+			{ TEXT("MPSoftCorrections="), TEXT("mp.SoftCorrections") },
+			{ TEXT("MPSignificance="), TEXT("mp.Significance") },
+			{ TEXT("MPBatchServerMoves="), TEXT("mp.BatchServerMoves") },
+			{ TEXT("MPNetOverlay="), TEXT("mp.NetOverlay") },
+			{ TEXT("MPTrace="), TEXT("mp.Trace") },
+			{ TEXT("MPSnapshots="), TEXT("mp.Snapshots") },
+		};
+		for (const TCHAR* const* CommandLineCVar : CommandLineCVars)
+		{
+			// mp.Trace isn't there in shipping
+			int32 Value;
+			IConsoleVariable* CVar = IConsoleManager::Get().FindConsoleVariable(CommandLineCVar[1]);
+			if (CVar && FParse::Value(FCommandLine::Get(), CommandLineCVar[0], Value))
+			{
+				CVar->Set(Value, ECVF_SetByCommandline);
+			}
+		}
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FMovementPredictionModule, MovementPrediction, "MovementPrediction" );
  
\ No newline at end of file
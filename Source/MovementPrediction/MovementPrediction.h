@@ -3,3 +3,28 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+/** How well UReallyCoolMovementComponent predicts - see with "stat MovementPrediction", captured with "csvprofile start" */
+DECLARE_STATS_GROUP(TEXT("MovementPrediction"), STATGROUP_MovementPrediction, STATCAT_Advanced);
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(MOVEMENTPREDICTION_API, MovementPrediction);
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+/** Where the module's memory goes - see with "stat LLMFULL", captured with -llmcsv */
+enum class EMovementPredictionLLMTag : int32
+{
+	SavedMoves = (int32)ELLMTag::ProjectTagStart,
+	PredictionData,
+	Projectiles,
+};
+
+#define LLM_SCOPE_MOVEMENTPREDICTION(Tag) LLM_SCOPE((ELLMTag)EMovementPredictionLLMTag::Tag)
+
+#else
+
+#define LLM_SCOPE_MOVEMENTPREDICTION(Tag)
+
+#endif
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementPredictionBotComponent.h"
+#include "MovementPredictionCharacter.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "HAL/PlatformProcess.h"
+
+UMovementPredictionBotComponent::UMovementPredictionBotComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+
+	Pattern = EBotInputPattern::Mixed;
+	StrafePeriod = 1.5f;
+	CircleTurnRate = 90.f;
+	DashInterval = 2.f;
+	FireInterval = 0.5f;
+
+	ElapsedTime = 0.f;
+	NextDashTime = 0.f;
+	NextFireTime = 0.f;
+}
+
+bool UMovementPredictionBotComponent::GetCommandLinePattern(EBotInputPattern& OutPattern)
+{
+	FString PatternName;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("MPBot="), PatternName))
+	{
+		return false;
+	}
+
+	const UEnum* PatternEnum = StaticEnum<EBotInputPattern>();
+	const int64 PatternValue = PatternEnum->GetValueByNameString(PatternName);
+	OutPattern = PatternValue != INDEX_NONE ? static_cast<EBotInputPattern>(PatternValue) : EBotInputPattern::Mixed;
+
+	return true;
+}
+
+void UMovementPredictionBotComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	int32 Seed = FPlatformProcess::GetCurrentProcessId();
+	FParse::Value(FCommandLine::Get(), TEXT("MPBotSeed="), Seed);
+	RandomStream.Initialize(Seed);
+
+	// Start every bot at a different point in its pattern
+	ElapsedTime = RandomStream.FRandRange(0.f, StrafePeriod * 2.f);
+	NextDashTime = ElapsedTime + RandomStream.FRandRange(0.f, DashInterval);
+	NextFireTime = ElapsedTime + RandomStream.FRandRange(0.f, FireInterval);
+}
+
+void UMovementPredictionBotComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	AMovementPredictionCharacter* Character = Cast<AMovementPredictionCharacter>(GetOwner());
+	if (!Character || !Character->IsLocallyControlled())
+	{
+		return;
+	}
+
+	ElapsedTime += DeltaTime;
+
+	const bool bStrafe = Pattern != EBotInputPattern::Circle;
+	const bool bCircle = Pattern == EBotInputPattern::Circle || Pattern == EBotInputPattern::Mixed;
+	const bool bDash = Pattern == EBotInputPattern::Dash || Pattern == EBotInputPattern::Mixed;
+	const bool bFire = Pattern == EBotInputPattern::Mixed;
+
+	if (bStrafe)
+	{
+		const bool bStrafeRight = FMath::Fmod(ElapsedTime, StrafePeriod * 2.f) < StrafePeriod;
+		Character->MoveRight(bStrafeRight ? 1.f : -1.f);
+	}
+
+	if (bCircle)
+	{
+		Character->MoveForward(1.f);
+		Character->AddControllerYawInput(CircleTurnRate * DeltaTime);
+	}
+
+	if (bDash && ElapsedTime >= NextDashTime)
+	{
+		Character->OnStartDash();
+		Character->OnStopDash();
+		NextDashTime = ElapsedTime + DashInterval;
+	}
+
+	if (bFire && ElapsedTime >= NextFireTime)
+	{
+		Character->OnFire();
+		NextFireTime = ElapsedTime + FireInterval;
+	}
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "MovementPredictionBotComponent.generated.h"
+
+class AMovementPredictionCharacter;
+
+/** Scripted input patterns for load testing */
+UENUM()
+enum class EBotInputPattern : uint8
+{
+	/** Strafe left and right */
+	Strafe,
+	/** Run in circles */
+	Circle,
+	/** Strafe and dash on a timer */
+	Dash,
+	/** All of the above plus firing */
+	Mixed,
+};
+
+/**
+ * Drives the owning character's input handlers with a scripted pattern, so headless clients can load a server.
+ * Added by the character when the game is started with -MPBot=<Pattern>.
+ */
+UCLASS()
+class UMovementPredictionBotComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMovementPredictionBotComponent();
+
+	// Begin UActorComponent Interface
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End UActorComponent Interface
+
+	/** Returns the pattern requested on the command line, false if this isn't a bot */
+	static bool GetCommandLinePattern(EBotInputPattern& OutPattern);
+
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	EBotInputPattern Pattern;
+
+	/** Seconds spent strafing in each direction */
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float StrafePeriod;
+
+	/** Degrees per second to turn while circling */
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float CircleTurnRate;
+
+	/** Seconds between dashes */
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float DashInterval;
+
+	/** Seconds between shots */
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float FireInterval;
+
+private:
+
+	// Spread bots out so they don't all dash on the same frame
+	FRandomStream RandomStream;
+
+	float ElapsedTime;
+	float NextDashTime;
+	float NextFireTime;
+};
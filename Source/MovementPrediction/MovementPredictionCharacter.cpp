@@ -1,18 +1,46 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "MovementPredictionCharacter.h"
+#include "MovementPrediction.h"
+#include "MovementPredictionBotComponent.h"
+#include "MovementPredictionHUD.h"
+#include "MovementPredictionLagCompensation.h"
 #include "MovementPredictionProjectile.h"
+#include "MovementPredictionProjectileManager.h"
+#include "MovementPredictionProjectilePool.h"
+#include "MovementPredictionSignificanceManager.h"
+#include "MovementPredictionSnapshots.h"
+#include "MovementPredictionTrace.h"
 #include "Animation/AnimInstance.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/GameStateBase.h"
 #include "GameFramework/InputSettings.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
 #include "Kismet/GameplayStatics.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
 #include "Net/UnrealNetwork.h"
 #include "ReallyCoolMovementComponent.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogFPChar, Warning, All);
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server RPCs Dropped"), STAT_MovementPrediction_ServerRPCsDropped, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dashes Rewound"), STAT_MovementPrediction_DashesRewound, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dash Time Stamps Rejected"), STAT_MovementPrediction_DashTimeStampsRejected, STATGROUP_MovementPrediction);
+
+static TAutoConsoleVariable<int32> CVarDashUseMulticast(
+	TEXT("mp.DashUseMulticast"),
+	0,
+	TEXT("How the server tells other clients about dashes.\n")
+	TEXT("0: replicated dash state, culled by relevancy (default)\n")
+	TEXT("1: reliable multicast RPC to every connection"),
+	ECVF_Default);
+
 //////////////////////////////////////////////////////////////////////////
 // AMovementPredictionCharacter
 
@@ -59,9 +87,33 @@ AMovementPredictionCharacter::AMovementPredictionCharacter(const FObjectInitiali
 	DashDurationSeconds = 0.25f;
 	DashSpeed = 1000.f;
 	DashTimeLeft = 0.f;
+	MaxDashRewindSeconds = 0.2f;
+	PendingDashDir = FVector::ZeroVector;
+	PendingDashTimeStamp = 0.f;
+	PendingDashDeadline = 0.f;
+	bHasPendingDash = false;
+	SignificanceTickInterval = 0.f;
+
+	// Tick only runs the unpredicted dash, it's turned on when one starts
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	bReplicates = true;
 	bUseMovementPrediction = true;
+
+	MaxFireMuzzleError = 50.f;
+	MaxFireForwardSeconds = 0.2f;
+	MaxFireTimeStampError = 0.5f;
+	NextFireId = 0;
+
+	SnapshotId = 0;
+
+	// A few times what a player can do with the keyboard, so only floods get dropped
+	StartDashBudget = FServerRPCBudget(10.f, 5.f);
+	StopDashBudget = FServerRPCBudget(10.f, 5.f);
+	SetDashYawBudget = FServerRPCBudget(30.f, 10.f);
+	ToggleMovementPredictionBudget = FServerRPCBudget(2.f, 3.f);
+	FireBudget = FServerRPCBudget(20.f, 10.f);
+	AckSnapshotBudget = FServerRPCBudget(40.f, 20.f);
 }
 
 void AMovementPredictionCharacter::BeginPlay()
@@ -74,6 +126,78 @@ void AMovementPredictionCharacter::BeginPlay()
 
 	// Show or hide the two versions of the gun based on whether or not we're using motion controllers.
 	Mesh1P->SetHiddenInGame(false, true);
+
+	// Have projectiles waiting before the first shot rather than spawning them mid-fight, the server launches its own too
+	UWorld* World = GetWorld();
+	if (ProjectileClass && World)
+	{
+		if (UMovementPredictionProjectilePool* ProjectilePool = World->GetSubsystem<UMovementPredictionProjectilePool>())
+		{
+			ProjectilePool->Prewarm(ProjectileClass);
+		}
+	}
+
+	// The server keeps where everyone was so hits can be checked against what the shooter saw
+	if (HasAuthority() && World)
+	{
+		if (UMovementPredictionLagCompensation* LagCompensation = World->GetSubsystem<UMovementPredictionLagCompensation>())
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
+	}
+
+	// Other players' characters tick less often when they're far away or out of view
+	if (GetLocalRole() == ROLE_SimulatedProxy && World)
+	{
+		if (UMovementPredictionSignificanceManager* SignificanceManager = USignificanceManager::Get<UMovementPredictionSignificanceManager>(World))
+		{
+			SignificanceManager->RegisterCharacter(this);
+		}
+	}
+
+	// The server snapshots everyone, clients place the other players' characters from them
+	if ((HasAuthority() || GetLocalRole() == ROLE_SimulatedProxy) && World)
+	{
+		if (UMovementPredictionSnapshots* Snapshots = World->GetSubsystem<UMovementPredictionSnapshots>())
+		{
+			Snapshots->RegisterCharacter(this);
+		}
+	}
+
+	// Soak tests start everyone with prediction on or off
+	FParse::Bool(FCommandLine::Get(), TEXT("MPPrediction="), bUseMovementPrediction);
+
+	// Load test clients drive their own character with a scripted pattern
+	EBotInputPattern BotPattern;
+	if (GetNetMode() != NM_DedicatedServer && UMovementPredictionBotComponent::GetCommandLinePattern(BotPattern))
+	{
+		UMovementPredictionBotComponent* Bot = NewObject<UMovementPredictionBotComponent>(this, TEXT("Bot"));
+		Bot->Pattern = BotPattern;
+		Bot->RegisterComponent();
+	}
+}
+
+void AMovementPredictionCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UWorld* World = GetWorld())
+	{
+		if (UMovementPredictionLagCompensation* LagCompensation = World->GetSubsystem<UMovementPredictionLagCompensation>())
+		{
+			LagCompensation->UnregisterCharacter(this);
+		}
+
+		if (UMovementPredictionSignificanceManager* SignificanceManager = USignificanceManager::Get<UMovementPredictionSignificanceManager>(World))
+		{
+			SignificanceManager->UnregisterCharacter(this);
+		}
+
+		if (UMovementPredictionSnapshots* Snapshots = World->GetSubsystem<UMovementPredictionSnapshots>())
+		{
+			Snapshots->UnregisterCharacter(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -104,6 +228,7 @@ void AMovementPredictionCharacter::SetupPlayerInputComponent(class UInputCompone
 	PlayerInputComponent->BindAxis("LookUpRate", this, &AMovementPredictionCharacter::LookUpAtRate);
 
 	PlayerInputComponent->BindAction("TogglePrediction", IE_Pressed, this, &AMovementPredictionCharacter::ToggleMovementPrediction);
+	PlayerInputComponent->BindAction("ToggleNetOverlay", IE_Pressed, this, &AMovementPredictionCharacter::ToggleNetOverlay);
 
 	// Dash input
 	PlayerInputComponent->BindAction("Dash", IE_Pressed, this, &ThisClass::OnStartDash);
@@ -115,19 +240,40 @@ void AMovementPredictionCharacter::OnFire()
 	// try and fire a projectile
 	if (ProjectileClass != NULL)
 	{
-		UWorld* const World = GetWorld();
-		if (World != NULL)
-		{
-			const FRotator SpawnRotation = GetControlRotation();
-			// MuzzleOffset is in camera space, so transform it to world space before offsetting from the character location to find the final muzzle position
-			const FVector SpawnLocation = ((FP_MuzzleLocation != nullptr) ? FP_MuzzleLocation->GetComponentLocation() : GetActorLocation()) + SpawnRotation.RotateVector(GunOffset);
-
-			//Set Spawn Collision Handling Override
-			FActorSpawnParameters ActorSpawnParams;
-			ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+		const FRotator Aim = GetControlRotation();
+		const FVector Muzzle = GetMuzzleLocation(Aim);
 
-			// spawn the projectile at the muzzle
-			World->SpawnActor<AMovementPredictionProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
+		if (HasAuthority())
+		{
+			// Listen server, nothing to predict
+			LaunchProjectile(Muzzle, Aim);
+			MulticastRPC_Fire(Muzzle, FRotator::CompressAxisToShort(Aim.Pitch), FRotator::CompressAxisToShort(Aim.Yaw));
+		}
+		else
+		{
+			FPredictedFireEvent Event;
+			Event.Muzzle = Muzzle;
+			Event.AimPitch = FRotator::CompressAxisToShort(Aim.Pitch);
+			Event.AimYaw = FRotator::CompressAxisToShort(Aim.Yaw);
+			Event.FireId = NextFireId++;
+
+			const FNetworkPredictionData_Client_Character* ClientData = GetCharacterMovement() ? GetCharacterMovement()->GetPredictionData_Client_Character() : nullptr;
+			Event.TimeStamp = ClientData ? ClientData->CurrentTimeStamp : 0.f;
+
+			// Fire right away and let the server correct us, without prediction we wait for the multicast like everyone else
+			if (bUseMovementPrediction)
+			{
+				if (AMovementPredictionProjectile* Projectile = LaunchProjectile(Muzzle, Aim, 0.f, false))
+				{
+					FPredictedShot& Shot = PredictedShots[Event.FireId % NumPredictedShots];
+					Shot.Projectile = Projectile;
+					Shot.LaunchCount = Projectile->GetLaunchCount();
+					Shot.Muzzle = Muzzle;
+					Shot.FireId = Event.FireId;
+				}
+			}
+
+			ServerRPC_Fire(Event);
 		}
 	}
 
@@ -149,6 +295,145 @@ void AMovementPredictionCharacter::OnFire()
 	}
 }
 
+FVector AMovementPredictionCharacter::GetMuzzleLocation(const FRotator& Aim) const
+{
+	// MuzzleOffset is in camera space, so transform it to world space before offsetting from the character location to find the final muzzle position
+	const FTransform& CameraTransform = FirstPersonCameraComponent->GetComponentTransform();
+	const FVector GunMuzzle = (FP_MuzzleLocation != nullptr) ? FP_MuzzleLocation->GetComponentLocation() : GetActorLocation();
+	return CameraTransform.GetLocation() + Aim.RotateVector(CameraTransform.InverseTransformPosition(GunMuzzle) + GunOffset);
+}
+
+AMovementPredictionProjectile* AMovementPredictionCharacter::LaunchProjectile(const FVector& Muzzle, const FRotator& Aim, float FastForwardSeconds, bool bAllowBatched)
+{
+	UWorld* const World = GetWorld();
+	if (ProjectileClass == NULL || World == NULL)
+	{
+		return nullptr;
+	}
+
+	// batched when enabled, falling back to the pool when the batch is full
+	UMovementPredictionProjectileManager* ProjectileManager = (bAllowBatched && FastForwardSeconds <= 0.f && UMovementPredictionProjectileManager::IsEnabled()) ? World->GetSubsystem<UMovementPredictionProjectileManager>() : nullptr;
+	if (ProjectileManager && ProjectileManager->Launch(ProjectileClass, Muzzle, Aim))
+	{
+		TRACE_MOVEMENTPREDICTION_PROJECTILE_SPAWN(this, true, FastForwardSeconds);
+		return nullptr;
+	}
+
+	// launch a pooled projectile at the muzzle, the pool places it like AdjustIfPossibleButDontSpawnIfColliding would
+	UMovementPredictionProjectilePool* ProjectilePool = World->GetSubsystem<UMovementPredictionProjectilePool>();
+	AMovementPredictionProjectile* Projectile = ProjectilePool ? ProjectilePool->Acquire(ProjectileClass, Muzzle, Aim) : nullptr;
+	if (Projectile && FastForwardSeconds > 0.f)
+	{
+		Projectile->FastForward(FastForwardSeconds);
+	}
+
+	if (Projectile)
+	{
+		TRACE_MOVEMENTPREDICTION_PROJECTILE_SPAWN(this, false, FastForwardSeconds);
+	}
+
+	return Projectile;
+}
+
+float AMovementPredictionCharacter::GetLocalOneWayLatency() const
+{
+	const APlayerController* LocalController = GetWorld()->GetFirstPlayerController();
+	const APlayerState* LocalPlayerState = LocalController ? LocalController->PlayerState : nullptr;
+
+	// ExactPing is round trip in ms
+	return LocalPlayerState ? LocalPlayerState->ExactPing * 0.0005f : 0.f;
+}
+
+void AMovementPredictionCharacter::ServerRPC_Fire_Implementation(const FPredictedFireEvent& Event)
+{
+	if (!ConsumeRPCBudget(FireBudget, TEXT("ServerRPC_Fire")))
+	{
+		// Dropped without an answer so a flood costs us nothing to send, the client's predicted projectile just runs out its life
+		return;
+	}
+
+	const FRotator Aim(FRotator::DecompressAxisFromShort(Event.AimPitch), FRotator::DecompressAxisFromShort(Event.AimYaw), 0.f);
+
+	// The client's muzzle as long as it's about where ours is
+	const FVector ServerMuzzle = GetMuzzleLocation(Aim);
+	const bool bMuzzleAccepted = FVector::DistSquared(Event.Muzzle, ServerMuzzle) <= FMath::Square(MaxFireMuzzleError);
+	const FVector Muzzle = bMuzzleAccepted ? FVector(Event.Muzzle) : ServerMuzzle;
+
+	// The shot left the client half a ping ago, plus however far it's behind the newest move we've simulated
+	float ForwardSeconds = 0.f;
+	const UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(GetCharacterMovement());
+	float BehindSeconds = 0.f;
+	if (Movement && Movement->GetClientTimeStampAge(Event.TimeStamp, BehindSeconds))
+	{
+		if (FMath::Abs(BehindSeconds) > MaxFireTimeStampError)
+		{
+			ClientRPC_CorrectFire(Event.FireId, false, Muzzle);
+			return;
+		}
+
+		ForwardSeconds += FMath::Max(BehindSeconds, 0.f);
+	}
+
+	ForwardSeconds += GetRoundTripTime() * 0.5f;
+
+	LaunchProjectile(Muzzle, Aim, FMath::Min(ForwardSeconds, MaxFireForwardSeconds), false);
+	MulticastRPC_Fire(Muzzle, Event.AimPitch, Event.AimYaw);
+
+	if (!bMuzzleAccepted)
+	{
+		ClientRPC_CorrectFire(Event.FireId, true, Muzzle);
+	}
+}
+
+bool AMovementPredictionCharacter::ServerRPC_Fire_Validate(const FPredictedFireEvent& Event)
+{
+	return true;
+}
+
+void AMovementPredictionCharacter::ClientRPC_CorrectFire_Implementation(uint8 FireId, bool bAccepted, FVector_NetQuantize10 Muzzle)
+{
+	FPredictedShot& Shot = PredictedShots[FireId % NumPredictedShots];
+	AMovementPredictionProjectile* Projectile = Shot.Projectile.Get();
+
+	// Already hit something and went back to the pool, maybe flying again as a newer shot
+	if (!Projectile || Shot.FireId != FireId || Projectile->GetLaunchCount() != Shot.LaunchCount)
+	{
+		return;
+	}
+
+	Shot.Projectile = nullptr;
+
+	if (!bAccepted)
+	{
+		if (UMovementPredictionProjectilePool* ProjectilePool = GetWorld()->GetSubsystem<UMovementPredictionProjectilePool>())
+		{
+			ProjectilePool->Release(Projectile);
+		}
+		return;
+	}
+
+	// Same flight, shifted over to where the server launched it from
+	Projectile->SetActorLocation(Projectile->GetActorLocation() + (Muzzle - Shot.Muzzle), false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+void AMovementPredictionCharacter::MulticastRPC_Fire_Implementation(FVector_NetQuantize10 Muzzle, uint16 AimPitch, uint16 AimYaw)
+{
+	// The server has the real one, a predicting shooter has its own
+	if (HasAuthority() || (IsLocallyControlled() && bUseMovementPrediction))
+	{
+		return;
+	}
+
+	// The server's projectile has been flying since it sent this
+	const FRotator Aim(FRotator::DecompressAxisFromShort(AimPitch), FRotator::DecompressAxisFromShort(AimYaw), 0.f);
+	LaunchProjectile(Muzzle, Aim, GetLocalOneWayLatency());
+
+	if (FireSound != NULL)
+	{
+		UGameplayStatics::PlaySoundAtLocation(this, FireSound, Muzzle);
+	}
+}
+
 void AMovementPredictionCharacter::MoveForward(float Value)
 {
 	if (Value != 0.0f)
@@ -183,6 +468,19 @@ void AMovementPredictionCharacter::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
+	// Start a dash that was waiting on the moves leading up to it, or on them not showing up
+	if (bHasPendingDash)
+	{
+		const UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(GetCharacterMovement());
+		float Age = 0.f;
+		const bool bCaughtUp = Movement && Movement->GetClientTimeStampAge(PendingDashTimeStamp, Age) && Age >= 0.f;
+		if (bCaughtUp || GetWorld()->GetTimeSeconds() >= PendingDashDeadline)
+		{
+			bHasPendingDash = false;
+			StartServerDash(PendingDashDir, FMath::Max(Age, 0.f));
+		}
+	}
+
 	// Update dash
 	if (DashTimeLeft > 0.f)
 	{
@@ -190,14 +488,61 @@ void AMovementPredictionCharacter::Tick(float DeltaSeconds)
 
 		//LaunchCharacter(CurrentDashDir * DashSpeed, true, true);
 		DashTimeLeft -= DeltaSeconds;
+
+		if (DashTimeLeft <= 0.f && HasAuthority())
+		{
+			OnMovementDashEnded();
+		}
+	}
+
+	if (DashTimeLeft <= 0.f && !bHasPendingDash)
+	{
+		SetActorTickEnabled(false);
 	}
 }
 
+void AMovementPredictionCharacter::SetSignificanceTickInterval(float TickInterval)
+{
+	if (SignificanceTickInterval == TickInterval)
+	{
+		return;
+	}
+	SignificanceTickInterval = TickInterval;
+
+	if (UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(GetCharacterMovement()))
+	{
+		Movement->SetSimulatedTickInterval(TickInterval);
+	}
+
+	// Animation only, the meshes follow the capsule through their attachment either way
+	TInlineComponentArray<USkeletalMeshComponent*> SkeletalMeshes(this);
+	for (USkeletalMeshComponent* SkeletalMesh : SkeletalMeshes)
+	{
+		SkeletalMesh->SetComponentTickInterval(TickInterval);
+	}
+}
+
+void AMovementPredictionCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// The owner predicts its own dash
+	DOREPLIFETIME_CONDITION(AMovementPredictionCharacter, ReplicatedDashState, COND_SimulatedOnly);
+
+	// Fixed for the character's life, clients need it before BeginPlay
+	DOREPLIFETIME_CONDITION(AMovementPredictionCharacter, SnapshotId, COND_InitialOnly);
+}
+
 void AMovementPredictionCharacter::ToggleMovementPrediction()
 {
 	ServerRPC_ToggleMovementPrediction();
 }
 
+void AMovementPredictionCharacter::ToggleNetOverlay()
+{
+	AMovementPredictionHUD::ToggleNetOverlay();
+}
+
 void AMovementPredictionCharacter::MulticastRPC_ToggleMovementPrediction_Implementation()
 {
 	bUseMovementPrediction = !bUseMovementPrediction;
@@ -206,6 +551,7 @@ void AMovementPredictionCharacter::MulticastRPC_ToggleMovementPrediction_Impleme
 	{
 		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Prediction turned ON!"));
 	}
+	else
 	{
 		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Prediction turned OFF!"));
 	}
@@ -213,6 +559,11 @@ void AMovementPredictionCharacter::MulticastRPC_ToggleMovementPrediction_Impleme
 
 void AMovementPredictionCharacter::ServerRPC_ToggleMovementPrediction_Implementation()
 {
+	if (!ConsumeRPCBudget(ToggleMovementPredictionBudget, TEXT("ServerRPC_ToggleMovementPrediction")))
+	{
+		return;
+	}
+
 	MulticastRPC_ToggleMovementPrediction();
 }
 
@@ -241,7 +592,18 @@ void AMovementPredictionCharacter::StartDash(const FVector& DashDir, bool bFromR
 			return;
 		}
 
-		ServerRPC_StartDash(DashDir);
+		// The predicted dash reaches the server through the move stream, only the jank version needs its own RPC.
+		// Stamped with where our moves are, so the server can start it where we did rather than when the RPC lands.
+		if (!bUseMovementPrediction)
+		{
+			const FNetworkPredictionData_Client_Character* ClientData = GetCharacterMovement() ? GetCharacterMovement()->GetPredictionData_Client_Character() : nullptr;
+			ServerRPC_StartDash(ClientData ? ClientData->CurrentTimeStamp : 0.f, DashDir);
+		}
+	}
+	else if (bFromReplication && HasAuthority())
+	{
+		// The server started this dash itself, in the movement component or StartServerDash
+		return;
 	}
 
 	// Start the dash on the movement component
@@ -256,6 +618,7 @@ void AMovementPredictionCharacter::StartDash(const FVector& DashDir, bool bFromR
 	{
 		CurrentDashDir = DashDir;
 		DashTimeLeft = DashDurationSeconds;
+		SetActorTickEnabled(true);
 	}
 }
 
@@ -271,6 +634,11 @@ void AMovementPredictionCharacter::MulticastRPC_StopDash_Implementation()
 
 void AMovementPredictionCharacter::ServerRPC_StopDash_Implementation()
 {
+	if (!ConsumeRPCBudget(StopDashBudget, TEXT("ServerRPC_StopDash")))
+	{
+		return;
+	}
+
 	MulticastRPC_StopDash();
 }
 
@@ -284,12 +652,251 @@ void AMovementPredictionCharacter::MulticastRPC_StartDash_Implementation(const F
 	StartDash(DashDir, true);
 }
 
-void AMovementPredictionCharacter::ServerRPC_StartDash_Implementation(const FVector& DashDir)
+void AMovementPredictionCharacter::ServerRPC_StartDash_Implementation(float ClientTimeStamp, const FVector& DashDir)
 {
-	MulticastRPC_StartDash(DashDir);
+	if (!ConsumeRPCBudget(StartDashBudget, TEXT("ServerRPC_StartDash")))
+	{
+		return;
+	}
+
+	// How far the moves we've simulated are past the press. Anything outside the window is a bad clock or a cheat, start it now.
+	float Age = 0.f;
+	const UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(GetCharacterMovement());
+	if (Movement && Movement->GetClientTimeStampAge(ClientTimeStamp, Age) && FMath::Abs(Age) > MaxDashRewindSeconds)
+	{
+		Age = 0.f;
+		INC_DWORD_STAT(STAT_MovementPrediction_DashTimeStampsRejected);
+		CSV_CUSTOM_STAT(MovementPrediction, DashTimeStampsRejected, 1, ECsvCustomStatOp::Accumulate);
+	}
+
+	// Reliable RPCs can overtake the unreliable moves before them, hold it until those moves have been simulated
+	if (Age < 0.f)
+	{
+		PendingDashDir = DashDir;
+		PendingDashTimeStamp = ClientTimeStamp;
+		PendingDashDeadline = GetWorld()->GetTimeSeconds() + MaxDashRewindSeconds;
+		bHasPendingDash = true;
+		SetActorTickEnabled(true);
+		return;
+	}
+
+	StartServerDash(DashDir, Age);
 }
 
-bool AMovementPredictionCharacter::ServerRPC_StartDash_Validate(const FVector& DashDir)
+bool AMovementPredictionCharacter::ServerRPC_StartDash_Validate(float ClientTimeStamp, const FVector& DashDir)
 {
 	return true;
 }
+
+void AMovementPredictionCharacter::StartServerDash(const FVector& DashDir, float ElapsedSeconds)
+{
+	check(HasAuthority());
+
+	const float Elapsed = FMath::Clamp(ElapsedSeconds, 0.f, DashDurationSeconds);
+	CurrentDashDir = DashDir;
+	DashTimeLeft = DashDurationSeconds - Elapsed;
+	SetActorTickEnabled(true);
+
+	// The client's moves since the press already have it dashing, cover the same ground in one go
+	if (Elapsed > 0.f)
+	{
+		AddActorWorldOffset(DashDir * DashSpeed * Elapsed, true);
+
+		INC_DWORD_STAT(STAT_MovementPrediction_DashesRewound);
+		CSV_CUSTOM_STAT(MovementPrediction, DashesRewound, 1, ECsvCustomStatOp::Accumulate);
+	}
+
+	BroadcastDash(DashDir, Elapsed);
+}
+
+void AMovementPredictionCharacter::OnMovementDashStarted(const FVector& DashDir)
+{
+	BroadcastDash(DashDir);
+}
+
+void AMovementPredictionCharacter::OnMovementDashEnded()
+{
+	ReplicatedDashState.bActive = false;
+}
+
+void AMovementPredictionCharacter::BroadcastDash(const FVector& DashDir, float ElapsedSeconds /*= 0.f*/)
+{
+	check(HasAuthority());
+
+	// Snapshots carry the dash to everyone else while they're on, see UMovementPredictionSnapshots
+	if (!IsReplicatingMovement())
+	{
+		return;
+	}
+
+	if (CVarDashUseMulticast.GetValueOnGameThread() != 0)
+	{
+		MulticastRPC_StartDash(DashDir);
+		return;
+	}
+
+	ReplicatedDashState.StartTime = GetWorld()->GetTimeSeconds() - ElapsedSeconds;
+	ReplicatedDashState.DashYaw = UReallyCoolMovementComponent::CompressDashDir(DashDir);
+	ReplicatedDashState.bActive = true;
+
+	// Get it out this net update if we're relevant, rather than waiting on NetUpdateFrequency
+	ForceNetUpdate();
+}
+
+void AMovementPredictionCharacter::StartSimulatedDash(const FVector& DashDir, float ElapsedSeconds)
+{
+	// Sent just before the server switched to snapshots, which place us now
+	UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(GetCharacterMovement());
+	if (Movement && Movement->IsSnapshotInterpolated())
+	{
+		return;
+	}
+
+	if (bUseMovementPrediction)
+	{
+		if (Movement)
+		{
+			Movement->StartSimulatedDash(DashDir, ElapsedSeconds);
+		}
+	}
+	else
+	{
+		CurrentDashDir = DashDir;
+		DashTimeLeft = DashDurationSeconds - ElapsedSeconds;
+		SetActorTickEnabled(true);
+	}
+}
+
+void AMovementPredictionCharacter::OnRep_ReplicatedDashState()
+{
+	if (!ReplicatedDashState.bActive)
+	{
+		// Let the local dash run out on its own, snapping it off here would pop
+		return;
+	}
+
+	// We might have become relevant halfway through the dash
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const float ServerTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	const float ElapsedSeconds = FMath::Max(ServerTime - ReplicatedDashState.StartTime, 0.f);
+
+	if (ElapsedSeconds < DashDurationSeconds)
+	{
+		StartSimulatedDash(UReallyCoolMovementComponent::DecompressDashDir(ReplicatedDashState.DashYaw), ElapsedSeconds);
+	}
+}
+
+float AMovementPredictionCharacter::GetRoundTripTime() const
+{
+	// Our own client measures it on the movement clock, everyone else only has the ping the server measured
+	const UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(GetCharacterMovement());
+	if (Movement && IsLocallyControlled() && !HasAuthority())
+	{
+		const float RoundTripTime = Movement->GetSmoothedRoundTripTime();
+		if (RoundTripTime > 0.f)
+		{
+			return RoundTripTime;
+		}
+	}
+
+	// ExactPing is round trip in ms
+	const APlayerState* State = GetPlayerState();
+	return State ? State->ExactPing * 0.001f : 0.f;
+}
+
+float AMovementPredictionCharacter::GetRoundTripTimeVariation() const
+{
+	const UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(GetCharacterMovement());
+	return (Movement && IsLocallyControlled() && !HasAuthority()) ? Movement->GetRoundTripTimeVariation() : 0.f;
+}
+
+void AMovementPredictionCharacter::ServerRPC_SetDashYaw_Implementation(uint16 DashYaw)
+{
+	if (!ConsumeRPCBudget(SetDashYawBudget, TEXT("ServerRPC_SetDashYaw")))
+	{
+		return;
+	}
+
+	if (UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(GetCharacterMovement()))
+	{
+		Movement->SetServerDashYaw(DashYaw);
+	}
+}
+
+bool AMovementPredictionCharacter::ServerRPC_SetDashYaw_Validate(uint16 DashYaw)
+{
+	return true;
+}
+
+void AMovementPredictionCharacter::ClientRPC_ReceiveSnapshot_Implementation(const FMovementSnapshotPacket& Packet)
+{
+	if (UMovementPredictionSnapshots* Snapshots = GetWorld()->GetSubsystem<UMovementPredictionSnapshots>())
+	{
+		Snapshots->ReceiveSnapshot(this, Packet);
+	}
+}
+
+void AMovementPredictionCharacter::ServerRPC_AckSnapshot_Implementation(uint32 InSnapshotId)
+{
+	if (!ConsumeRPCBudget(AckSnapshotBudget, TEXT("ServerRPC_AckSnapshot")))
+	{
+		return;
+	}
+
+	if (UMovementPredictionSnapshots* Snapshots = GetWorld()->GetSubsystem<UMovementPredictionSnapshots>())
+	{
+		Snapshots->AckSnapshot(this, InSnapshotId);
+	}
+}
+
+bool AMovementPredictionCharacter::ServerRPC_AckSnapshot_Validate(uint32 InSnapshotId)
+{
+	return true;
+}
+
+bool FServerRPCBudget::TryConsume(double Now)
+{
+	if (CallsPerSecond <= 0.f)
+	{
+		return true;
+	}
+
+	// Starts full, then refills at CallsPerSecond up to the burst
+	const float Capacity = FMath::Max(MaxBurst, 1.f);
+	Tokens = LastCallTime < 0.0 ? Capacity : FMath::Min(Tokens + float(Now - LastCallTime) * CallsPerSecond, Capacity);
+	LastCallTime = Now;
+
+	if (Tokens < 1.f)
+	{
+		++NumDropped;
+		return false;
+	}
+
+	Tokens -= 1.f;
+	return true;
+}
+
+bool AMovementPredictionCharacter::ConsumeRPCBudget(FServerRPCBudget& Budget, const TCHAR* RPCName)
+{
+	if (Budget.TryConsume(GetWorld()->GetRealTimeSeconds()))
+	{
+		return true;
+	}
+
+	INC_DWORD_STAT(STAT_MovementPrediction_ServerRPCsDropped);
+	CSV_CUSTOM_STAT(MovementPrediction, ServerRPCsDropped, 1, ECsvCustomStatOp::Accumulate);
+
+	// 1st, 2nd, 4th, 8th... so a flood can't flood the log as well
+	if (FMath::IsPowerOfTwo(Budget.NumDropped))
+	{
+		UE_LOG(LogFPChar, Warning, TEXT("%s: %s over budget (%.1f/s), %u calls dropped so far"), *GetName(), RPCName, Budget.CallsPerSecond, Budget.NumDropped);
+	}
+
+	return false;
+}
+
+uint32 AMovementPredictionCharacter::GetNumServerRPCsDropped() const
+{
+	return StartDashBudget.NumDropped + StopDashBudget.NumDropped + SetDashYawBudget.NumDropped + ToggleMovementPredictionBudget.NumDropped + FireBudget.NumDropped
+		+ AckSnapshotBudget.NumDropped;
+}
@@ -4,15 +4,127 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Engine/NetSerialization.h"
+#include "MovementPredictionSnapshots.h"
 #include "MovementPredictionCharacter.generated.h"
 
 class UInputComponent;
 
+/** Dash state simulated proxies need to reconstruct a dash locally */
+USTRUCT()
+struct FReplicatedDashState
+{
+	GENERATED_BODY()
+
+	/** Server world time the dash started at */
+	UPROPERTY()
+	float StartTime;
+
+	/** Compressed dash yaw */
+	UPROPERTY()
+	uint16 DashYaw;
+
+	/** Whether the dash is still running on the server */
+	UPROPERTY()
+	uint8 bActive : 1;
+
+	FReplicatedDashState()
+		: StartTime(0.f)
+		, DashYaw(0)
+		, bActive(false)
+	{
+	}
+};
+
+/** A shot fired by an owning client, sent to the server while the client's own projectile is already flying */
+USTRUCT()
+struct FPredictedFireEvent
+{
+	GENERATED_BODY()
+
+	/** Movement component client time stamp the shot was fired at, same clock as ServerMove */
+	UPROPERTY()
+	float TimeStamp;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Muzzle;
+
+	/** Compressed aim pitch and yaw */
+	UPROPERTY()
+	uint16 AimPitch;
+
+	UPROPERTY()
+	uint16 AimYaw;
+
+	/** Lets the server's correction find the predicted projectile */
+	UPROPERTY()
+	uint8 FireId;
+
+	FPredictedFireEvent()
+		: TimeStamp(0.f)
+		, Muzzle(ForceInitToZero)
+		, AimPitch(0)
+		, AimYaw(0)
+		, FireId(0)
+	{
+	}
+};
+
+/** Token bucket for one server RPC from one client, calls over budget are dropped before they do anything */
+USTRUCT()
+struct FServerRPCBudget
+{
+	GENERATED_BODY()
+
+	/** Calls per second a client can keep up, 0 for no limit */
+	UPROPERTY(EditDefaultsOnly, Category = "RPC Budget")
+	float CallsPerSecond;
+
+	/** Calls a client can make back to back before CallsPerSecond kicks in */
+	UPROPERTY(EditDefaultsOnly, Category = "RPC Budget")
+	float MaxBurst;
+
+	float Tokens;
+
+	/** Server real time of the last call, negative before the first */
+	double LastCallTime;
+
+	uint32 NumDropped;
+
+	FServerRPCBudget()
+		: FServerRPCBudget(0.f, 0.f)
+	{
+	}
+
+	FServerRPCBudget(float InCallsPerSecond, float InMaxBurst)
+		: CallsPerSecond(InCallsPerSecond)
+		, MaxBurst(InMaxBurst)
+		, Tokens(0.f)
+		, LastCallTime(-1.0)
+		, NumDropped(0)
+	{
+	}
+
+	/** Spends a call if there's one left at Now, false if the call should be dropped */
+	bool TryConsume(double Now);
+};
+
+/** A projectile the owning client launched before the server heard about the shot */
+struct FPredictedShot
+{
+	TWeakObjectPtr<class AMovementPredictionProjectile> Projectile;
+	uint32 LaunchCount = 0;
+	FVector Muzzle = FVector::ZeroVector;
+	uint8 FireId = 0;
+};
+
 UCLASS(config=Game)
 class AMovementPredictionCharacter : public ACharacter
 {
 	GENERATED_UCLASS_BODY()
 
+	friend class UMovementPredictionBotComponent;
+
 	/** Pawn mesh: 1st person view (arms; seen only by self) */
 	UPROPERTY(VisibleDefaultsOnly, Category = Mesh)
 	class USkeletalMeshComponent* Mesh1P;
@@ -31,6 +143,7 @@ class AMovementPredictionCharacter : public ACharacter
 
 protected:
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
@@ -86,16 +199,24 @@ protected:
 	virtual void SetupPlayerInputComponent(UInputComponent* InputComponent) override;
 	// End of APawn interface
 
+	// AActor interface
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	// End of AActor interface
+
 public:
 	/** Returns Mesh1P subobject **/
 	FORCEINLINE class USkeletalMeshComponent* GetMesh1P() const { return Mesh1P; }
 	/** Returns FirstPersonCameraComponent subobject **/
 	FORCEINLINE class UCameraComponent* GetFirstPersonCameraComponent() const { return FirstPersonCameraComponent; }
+	/** Returns if this character is predicting its movement and firing **/
+	FORCEINLINE bool IsUsingMovementPrediction() const { return bUseMovementPrediction; }
 
 private:
 
 	void ToggleMovementPrediction();
 
+	void ToggleNetOverlay();
+
 	UFUNCTION(Server, Reliable, WithValidation)
 	void ServerRPC_ToggleMovementPrediction();
 
@@ -117,8 +238,21 @@ protected:
 	void StartDash(const FVector& DashDir, bool bFromReplication = false);
 	void StopDash(bool bFromReplication = false);
 
+	/** Server only - lets every other client know about a dash that started ElapsedSeconds ago, either through ReplicatedDashState or the multicast */
+	void BroadcastDash(const FVector& DashDir, float ElapsedSeconds = 0.f);
+
+	/** Server only - starts the unpredicted dash ElapsedSeconds in, catching up on the ground the client has already covered */
+	void StartServerDash(const FVector& DashDir, float ElapsedSeconds);
+
+	/** Picks up a dash that's already been running for ElapsedSeconds on the server */
+	void StartSimulatedDash(const FVector& DashDir, float ElapsedSeconds);
+
+	UFUNCTION()
+	void OnRep_ReplicatedDashState();
+
+	/** Unpredicted dash, ClientTimeStamp is the movement component's client time stamp when it was pressed, same clock as ServerMove */
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerRPC_StartDash(const FVector& DashDir);
+	void ServerRPC_StartDash(float ClientTimeStamp, const FVector& DashDir);
 
 	UFUNCTION(NetMulticast, Reliable)
 	void MulticastRPC_StartDash(const FVector& DashDir);
@@ -129,6 +263,34 @@ protected:
 	UFUNCTION(NetMulticast, Reliable)
 	void MulticastRPC_StopDash();
 
+public:
+
+	/** Called by the movement component on the server when a predicted dash starts, so everyone else sees it too */
+	void OnMovementDashStarted(const FVector& DashDir);
+
+	/** Called by the movement component on the server when a predicted dash runs out */
+	void OnMovementDashEnded();
+
+	/** How often the significance manager wants this character's movement and meshes to tick, 0 for every frame */
+	void SetSignificanceTickInterval(float TickInterval);
+
+	/** Sends the compressed dash direction in the same packet as the move that starts the dash */
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerRPC_SetDashYaw(uint16 DashYaw);
+
+	/**
+	 * Round trip time to the server in seconds. The owning client measures it from its own moves being acked, on the
+	 * movement clock; the server and everyone else get the ping the server measured.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Network")
+	float GetRoundTripTime() const;
+
+	/** Owning client only - how much GetRoundTripTime moves around, in seconds */
+	UFUNCTION(BlueprintCallable, Category = "Network")
+	float GetRoundTripTimeVariation() const;
+
+protected:
+
 	UPROPERTY(EditDefaultsOnly, Category = "Dash")
 	float DashDurationSeconds;
 
@@ -136,8 +298,136 @@ protected:
 	float DashSpeed;
 
 	FVector CurrentDashDir;
+
+	/** Time left on the unpredicted dash, Tick only runs while it's above 0 */
 	float DashTimeLeft;
 
+	/**
+	 * Furthest from the newest move the server has simulated that an unpredicted dash's time stamp can be. Dashes stamped
+	 * further back start when they arrive, ones ahead of the moves wait at most this long for them.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Dash")
+	float MaxDashRewindSeconds;
+
+	// Server only - an unpredicted dash stamped ahead of the newest move, started by Tick once the moves catch up
+	FVector PendingDashDir;
+	float PendingDashTimeStamp;
+	float PendingDashDeadline;
+	uint8 bHasPendingDash : 1;
+
+	float SignificanceTickInterval;
+
+	/** Dash state for simulated proxies, goes through normal property replication so relevancy and priority apply */
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedDashState)
+	FReplicatedDashState ReplicatedDashState;
+
+#pragma endregion
+
+#pragma region Fire
+protected:
+
+	/** Where a shot aimed along Aim leaves the gun. Goes through the camera's frame, the server neither pitches the camera nor animates the arms. */
+	FVector GetMuzzleLocation(const FRotator& Aim) const;
+
+	/**
+	 * Puts a projectile in the air, simulated FastForwardSeconds ahead so it's where it would be had it been fired that long ago.
+	 * Only pooled projectiles can be fast forwarded or corrected later, returns nullptr for batched ones.
+	 */
+	class AMovementPredictionProjectile* LaunchProjectile(const FVector& Muzzle, const FRotator& Aim, float FastForwardSeconds = 0.f, bool bAllowBatched = true);
+
+	/** Seconds since the server sent what we just received, half our ping */
+	float GetLocalOneWayLatency() const;
+
+	/** Spawns the authoritative projectile, fast forwarded by how long ago the client fired it */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerRPC_Fire(const FPredictedFireEvent& Event);
+
+	/** Only sent when the server moved or refused a predicted shot */
+	UFUNCTION(Client, Unreliable)
+	void ClientRPC_CorrectFire(uint8 FireId, bool bAccepted, FVector_NetQuantize10 Muzzle);
+
+	/** Cosmetic projectile for everyone who didn't fire it */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastRPC_Fire(FVector_NetQuantize10 Muzzle, uint16 AimPitch, uint16 AimYaw);
+
+	/** Furthest the client's muzzle can be from where the server puts it before the server uses its own */
+	UPROPERTY(EditDefaultsOnly, Category = "Fire")
+	float MaxFireMuzzleError;
+
+	/** Most a shot gets fast forwarded on the server, higher pings get that much less lead */
+	UPROPERTY(EditDefaultsOnly, Category = "Fire")
+	float MaxFireForwardSeconds;
+
+	/** Shots stamped further than this from the newest move the server has are refused */
+	UPROPERTY(EditDefaultsOnly, Category = "Fire")
+	float MaxFireTimeStampError;
+
+	/** Predicted projectiles waiting on a possible correction, by FireId */
+	static const int32 NumPredictedShots = 16;
+	FPredictedShot PredictedShots[NumPredictedShots];
+
+	uint8 NextFireId;
+
+#pragma endregion
+
+#pragma region Snapshots
+public:
+
+	/** Our client's snapshot of everyone else, see UMovementPredictionSnapshots */
+	UFUNCTION(Client, Unreliable)
+	void ClientRPC_ReceiveSnapshot(const FMovementSnapshotPacket& Packet);
+
+	/** Tells the server which snapshot to delta the next ones against */
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerRPC_AckSnapshot(uint32 InSnapshotId);
+
+	FORCEINLINE uint16 GetSnapshotId() const { return SnapshotId; }
+	FORCEINLINE void SetSnapshotId(uint16 InSnapshotId) { SnapshotId = InSnapshotId; }
+
+protected:
+
+	/** Which character this is in snapshots, given out by the server */
+	UPROPERTY(Replicated)
+	uint16 SnapshotId;
+
+#pragma endregion
+
+#pragma region RPC Budget
+public:
+
+	/** Server only - calls from our client dropped for going over budget, every RPC together */
+	uint32 GetNumServerRPCsDropped() const;
+
+protected:
+
+	/**
+	 * Server only - spends one of Budget's calls, returns false if our client is over budget and the call should be dropped.
+	 * Checked first thing in the _Implementation rather than in _Validate, failing validation would kick the client.
+	 */
+	bool ConsumeRPCBudget(FServerRPCBudget& Budget, const TCHAR* RPCName);
+
+	// One budget per server RPC, every character is one client's only pawn so these are per connection
+
+	UPROPERTY(EditDefaultsOnly, Category = "RPC Budget")
+	FServerRPCBudget StartDashBudget;
+
+	UPROPERTY(EditDefaultsOnly, Category = "RPC Budget")
+	FServerRPCBudget StopDashBudget;
+
+	/** Sent with the moves that start a dash, and again with their resends */
+	UPROPERTY(EditDefaultsOnly, Category = "RPC Budget")
+	FServerRPCBudget SetDashYawBudget;
+
+	UPROPERTY(EditDefaultsOnly, Category = "RPC Budget")
+	FServerRPCBudget ToggleMovementPredictionBudget;
+
+	UPROPERTY(EditDefaultsOnly, Category = "RPC Budget")
+	FServerRPCBudget FireBudget;
+
+	/** One per snapshot received, so twice the default SnapshotRate */
+	UPROPERTY(EditDefaultsOnly, Category = "RPC Budget")
+	FServerRPCBudget AckSnapshotBudget;
+
 #pragma endregion
 
 };
@@ -3,8 +3,19 @@
 #include "MovementPredictionGameMode.h"
 #include "MovementPredictionHUD.h"
 #include "MovementPredictionCharacter.h"
+#include "ReallyCoolMovementComponent.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
 #include "UObject/ConstructorHelpers.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogLoadReport, Log, All);
+
 AMovementPredictionGameMode::AMovementPredictionGameMode()
 	: Super()
 {
@@ -14,4 +25,128 @@ AMovementPredictionGameMode::AMovementPredictionGameMode()
 
 	// use our custom HUD class
 	HUDClass = AMovementPredictionHUD::StaticClass();
+
+	// Only ticks for load reports
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	LoadReportInterval = 5.f;
+	LoadReportTickMs = 0.0;
+	LoadReportMaxTickMs = 0.0;
+	LoadReportNumTicks = 0;
+	LoadReportElapsed = 0.f;
+	LoadReportLastCorrections = 0;
+	LoadReportLastPositionErrorSum = 0.0;
+	LoadReportLastPositionChecks = 0;
+	LoadReportLastUnderruns = 0;
+	LoadReportLastRespaced = 0;
+	LoadReportLastRPCsDropped = 0;
+}
+
+void AMovementPredictionGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (FParse::Value(FCommandLine::Get(), TEXT("MPLoadReport="), LoadReportPath))
+	{
+		FFileHelper::SaveStringToFile(TEXT("Time,Players,AvgTickMs,MaxTickMs,AvgInBytesPerSec,AvgOutBytesPerSec,MaxOutBytesPerSec,CorrectionsPerSec,MeanPositionError,AvgMoveBufferMs,MoveBufferUnderrunsPerSec,MovesRespacedPerSec,RPCsDroppedPerSec\n"), *LoadReportPath);
+		SetActorTickEnabled(true);
+	}
+}
+
+void AMovementPredictionGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// Busy time of the last frame, without the sleep that holds the server at its tick rate
+	const double TickMs = (FApp::GetDeltaTime() - FApp::GetIdleTime()) * 1000.0;
+	LoadReportTickMs += TickMs;
+	LoadReportMaxTickMs = FMath::Max(LoadReportMaxTickMs, TickMs);
+	LoadReportNumTicks++;
+
+	LoadReportElapsed += DeltaSeconds;
+	if (LoadReportElapsed >= LoadReportInterval)
+	{
+		WriteLoadReport();
+	}
+}
+
+void AMovementPredictionGameMode::WriteLoadReport()
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	const int32 NumConnections = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+
+	int64 TotalInBytesPerSec = 0;
+	int64 TotalOutBytesPerSec = 0;
+	int32 MaxOutBytesPerSec = 0;
+	if (NetDriver)
+	{
+		for (const UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			TotalInBytesPerSec += Connection->InBytesPerSecond;
+			TotalOutBytesPerSec += Connection->OutBytesPerSecond;
+			MaxOutBytesPerSec = FMath::Max(MaxOutBytesPerSec, Connection->OutBytesPerSecond);
+		}
+	}
+
+	uint64 TotalCorrections = 0;
+	double TotalPositionErrorSum = 0.0;
+	uint64 TotalPositionChecks = 0;
+	uint64 TotalUnderruns = 0;
+	uint64 TotalRespaced = 0;
+	uint64 TotalRPCsDropped = 0;
+	double TotalMoveBufferDelay = 0.0;
+	int32 NumMovements = 0;
+	for (TActorIterator<AMovementPredictionCharacter> It(GetWorld()); It; ++It)
+	{
+		TotalRPCsDropped += It->GetNumServerRPCsDropped();
+
+		if (const UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(It->GetCharacterMovement()))
+		{
+			TotalCorrections += Movement->GetNumCorrectionsSent();
+			TotalPositionErrorSum += Movement->GetServerPositionErrorSum();
+			TotalPositionChecks += Movement->GetNumServerPositionChecks();
+			TotalUnderruns += Movement->GetNumServerMoveBufferUnderruns();
+			TotalRespaced += Movement->GetNumServerMovesRespaced();
+			TotalMoveBufferDelay += Movement->GetServerMoveBufferDelay();
+			NumMovements++;
+		}
+	}
+
+	// Characters leaving take their counts with them
+	const uint64 NewCorrections = TotalCorrections > LoadReportLastCorrections ? TotalCorrections - LoadReportLastCorrections : 0;
+	const uint64 NewPositionChecks = TotalPositionChecks > LoadReportLastPositionChecks ? TotalPositionChecks - LoadReportLastPositionChecks : 0;
+	const double NewPositionErrorSum = FMath::Max(TotalPositionErrorSum - LoadReportLastPositionErrorSum, 0.0);
+	const uint64 NewUnderruns = TotalUnderruns > LoadReportLastUnderruns ? TotalUnderruns - LoadReportLastUnderruns : 0;
+	const uint64 NewRespaced = TotalRespaced > LoadReportLastRespaced ? TotalRespaced - LoadReportLastRespaced : 0;
+	const uint64 NewRPCsDropped = TotalRPCsDropped > LoadReportLastRPCsDropped ? TotalRPCsDropped - LoadReportLastRPCsDropped : 0;
+	LoadReportLastCorrections = TotalCorrections;
+	LoadReportLastPositionErrorSum = TotalPositionErrorSum;
+	LoadReportLastPositionChecks = TotalPositionChecks;
+	LoadReportLastUnderruns = TotalUnderruns;
+	LoadReportLastRespaced = TotalRespaced;
+	LoadReportLastRPCsDropped = TotalRPCsDropped;
+
+	const double AvgTickMs = LoadReportNumTicks > 0 ? LoadReportTickMs / LoadReportNumTicks : 0.0;
+	const double AvgInBytesPerSec = NumConnections > 0 ? double(TotalInBytesPerSec) / NumConnections : 0.0;
+	const double AvgOutBytesPerSec = NumConnections > 0 ? double(TotalOutBytesPerSec) / NumConnections : 0.0;
+	const double CorrectionsPerSec = NewCorrections / LoadReportElapsed;
+	const double MeanPositionError = NewPositionChecks > 0 ? NewPositionErrorSum / NewPositionChecks : 0.0;
+
+	// The server move buffer's delay right now, 0 with mp.ServerMoveBuffer off
+	const double AvgMoveBufferMs = NumMovements > 0 ? TotalMoveBufferDelay * 1000.0 / NumMovements : 0.0;
+
+	UE_LOG(LogLoadReport, Log, TEXT("%d players: %.2f ms/tick (max %.2f), %.0f/%.0f B/s in/out per connection, %.1f corrections/s, %.2f uu mean error"),
+		NumConnections, AvgTickMs, LoadReportMaxTickMs, AvgInBytesPerSec, AvgOutBytesPerSec, CorrectionsPerSec, MeanPositionError);
+
+	const FString Row = FString::Printf(TEXT("%.1f,%d,%.3f,%.3f,%.0f,%.0f,%d,%.2f,%.3f,%.2f,%.2f,%.2f,%.2f\n"),
+		GetWorld()->GetTimeSeconds(), NumConnections, AvgTickMs, LoadReportMaxTickMs, AvgInBytesPerSec, AvgOutBytesPerSec, MaxOutBytesPerSec, CorrectionsPerSec, MeanPositionError,
+		AvgMoveBufferMs, NewUnderruns / LoadReportElapsed, NewRespaced / LoadReportElapsed, NewRPCsDropped / LoadReportElapsed);
+	FFileHelper::SaveStringToFile(Row, *LoadReportPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	LoadReportTickMs = 0.0;
+	LoadReportMaxTickMs = 0.0;
+	LoadReportNumTicks = 0;
+	LoadReportElapsed = 0.f;
 }
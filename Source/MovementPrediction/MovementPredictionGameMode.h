@@ -13,6 +13,34 @@ class AMovementPredictionGameMode : public AGameModeBase
 
 public:
 	AMovementPredictionGameMode();
+
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+
+	/** Seconds covered by each load report row, only used when started with -MPLoadReport=<file.csv> */
+	UPROPERTY(EditDefaultsOnly, Category = "Load Test")
+	float LoadReportInterval;
+
+private:
+
+	/** Appends a row with server tick time, per-connection bandwidth and corrections to the load report */
+	void WriteLoadReport();
+
+	FString LoadReportPath;
+
+	// Accumulated since the last row
+	double LoadReportTickMs;
+	double LoadReportMaxTickMs;
+	int32 LoadReportNumTicks;
+	float LoadReportElapsed;
+	uint64 LoadReportLastCorrections;
+	double LoadReportLastPositionErrorSum;
+	uint64 LoadReportLastPositionChecks;
+	uint64 LoadReportLastUnderruns;
+	uint64 LoadReportLastRespaced;
+	uint64 LoadReportLastRPCsDropped;
 };
 
 
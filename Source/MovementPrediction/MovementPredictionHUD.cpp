@@ -1,19 +1,171 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "MovementPredictionHUD.h"
+#include "MovementPredictionCharacter.h"
+#include "ReallyCoolMovementComponent.h"
 #include "Engine/Canvas.h"
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
 #include "Engine/Texture2D.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
 #include "TextureResource.h"
 #include "CanvasItem.h"
 #include "UObject/ConstructorHelpers.h"
 
+static TAutoConsoleVariable<int32> CVarNetOverlay(
+	TEXT("mp.NetOverlay"),
+	0,
+	TEXT("Net prediction overlay on the HUD, also toggled with the ToggleNetOverlay action.\n")
+	TEXT("0: hidden (default)\n")
+	TEXT("1: rolling graphs of RTT, jitter, pending moves, ServerMove rate, bandwidth, corrections and dash mispredictions"),
+	ECVF_Default);
+
+// Net overlay layout, in canvas pixels
+static const float NetOverlayGraphWidth = 200.f;
+static const float NetOverlayGraphHeight = 32.f;
+static const float NetOverlayLabelHeight = 12.f;
+static const float NetOverlayMargin = 16.f;
+
+FNetOverlayGraph::FNetOverlayGraph(const TCHAR* InLabel, const TCHAR* InUnit, const FLinearColor& InColor)
+	: Label(InLabel)
+	, Unit(InUnit)
+	, Color(InColor)
+	, NextSample(0)
+{
+}
+
+void FNetOverlayGraph::Reset(int32 NumSamples)
+{
+	Samples.Reset();
+	Samples.SetNumZeroed(FMath::Max(NumSamples, 2));
+	NextSample = 0;
+}
+
+void FNetOverlayGraph::AddSample(float Value)
+{
+	Samples[NextSample] = Value;
+	NextSample = (NextSample + 1) % Samples.Num();
+}
+
+float FNetOverlayGraph::GetLatest() const
+{
+	return Samples[(NextSample + Samples.Num() - 1) % Samples.Num()];
+}
+
+float FNetOverlayGraph::GetMax() const
+{
+	float Max = 0.f;
+	for (const float Sample : Samples)
+	{
+		Max = FMath::Max(Max, Sample);
+	}
+	return Max;
+}
+
 AMovementPredictionHUD::AMovementPredictionHUD()
+	: RttGraph(TEXT("RTT"), TEXT("ms"), FLinearColor::Green)
+	, JitterGraph(TEXT("Jitter"), TEXT("ms"), FLinearColor(0.5f, 1.f, 0.5f))
+	, PendingMovesGraph(TEXT("Pending moves"), TEXT(""), FLinearColor::White)
+	, ServerMoveRateGraph(TEXT("ServerMoves"), TEXT("/s"), FLinearColor(0.3f, 0.6f, 1.f))
+	, OutBytesGraph(TEXT("Up"), TEXT("B/s"), FLinearColor(1.f, 0.6f, 0.2f))
+	, InBytesGraph(TEXT("Down"), TEXT("B/s"), FLinearColor(1.f, 0.9f, 0.2f))
+	, CorrectionRateGraph(TEXT("Corrections"), TEXT("/s"), FLinearColor::Red)
+	, DashMispredictionRateGraph(TEXT("Dash mispredictions"), TEXT("/s"), FLinearColor(1.f, 0.3f, 1.f))
 {
 	// Set the crosshair texture
 	static ConstructorHelpers::FObjectFinder<UTexture2D> CrosshairTexObj(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair"));
 	CrosshairTex = CrosshairTexObj.Object;
+
+	// The overlay samples even while it's hidden, so it has history as soon as it's shown
+	PrimaryActorTick.bCanEverTick = true;
+
+	NetOverlaySampleInterval = 0.1f;
+	NetOverlayNumSamples = 100;
+
+	NetOverlaySampleTimer = 0.f;
+	LastServerMovesSent = 0;
+	LastCorrectionsReceived = 0;
+	LastDashMispredictions = 0;
+	LastCorrectionError = 0.f;
+	TotalCorrections = 0;
+	TotalDashMispredictions = 0;
+	bPredicting = false;
+}
+
+void AMovementPredictionHUD::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (FNetOverlayGraph* Graph : { &RttGraph, &JitterGraph, &PendingMovesGraph, &ServerMoveRateGraph, &OutBytesGraph, &InBytesGraph, &CorrectionRateGraph, &DashMispredictionRateGraph })
+	{
+		Graph->Reset(NetOverlayNumSamples);
+	}
+}
+
+void AMovementPredictionHUD::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	NetOverlaySampleTimer += DeltaSeconds;
+	if (NetOverlaySampleTimer >= NetOverlaySampleInterval)
+	{
+		SampleNetOverlay(NetOverlaySampleTimer);
+		NetOverlaySampleTimer = 0.f;
+	}
 }
 
+void AMovementPredictionHUD::ToggleNetOverlay()
+{
+	CVarNetOverlay->Set(CVarNetOverlay.GetValueOnGameThread() != 0 ? 0 : 1, ECVF_SetByConsole);
+}
+
+void AMovementPredictionHUD::SampleNetOverlay(float SampleTime)
+{
+	// Counters restart when the character respawns, count from zero again rather than going negative
+	auto Delta = [](uint32 Current, uint32& Last)
+	{
+		const uint32 Result = Current >= Last ? Current - Last : Current;
+		Last = Current;
+		return Result;
+	};
+
+	const AMovementPredictionCharacter* Character = PlayerOwner ? Cast<AMovementPredictionCharacter>(PlayerOwner->GetPawn()) : nullptr;
+
+	// Measured per move on the client's movement clock, jitter is the RTT's mean deviation over those samples.
+	// ExactPing is already averaged, differencing it would understate jitter and lag behind it.
+	const APlayerState* LocalPlayerState = PlayerOwner ? PlayerOwner->PlayerState : nullptr;
+	const float Rtt = Character ? Character->GetRoundTripTime() * 1000.f : (LocalPlayerState ? LocalPlayerState->ExactPing : 0.f);
+	RttGraph.AddSample(Rtt);
+	JitterGraph.AddSample(Character ? Character->GetRoundTripTimeVariation() * 1000.f : 0.f);
+
+	const UNetConnection* Connection = PlayerOwner ? PlayerOwner->GetNetConnection() : nullptr;
+	OutBytesGraph.AddSample(Connection ? Connection->OutBytesPerSecond : 0.f);
+	InBytesGraph.AddSample(Connection ? Connection->InBytesPerSecond : 0.f);
+
+	const UReallyCoolMovementComponent* Movement = Character ? Cast<UReallyCoolMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+	bPredicting = Character && Character->IsUsingMovementPrediction();
+
+	// Only a client's autonomous proxy has prediction data, don't make some by asking for it
+	if (Movement && Movement->HasPredictionData_Client() && Character->GetLocalRole() == ROLE_AutonomousProxy)
+	{
+		const FNetworkPredictionData_Client_ReallyCoolMovez* ClientData = static_cast<const FNetworkPredictionData_Client_ReallyCoolMovez*>(Movement->GetPredictionData_Client());
+		PendingMovesGraph.AddSample(ClientData->SavedMoves.Num());
+		ServerMoveRateGraph.AddSample(Delta(ClientData->NumServerMovesSent, LastServerMovesSent) / SampleTime);
+		CorrectionRateGraph.AddSample(Delta(ClientData->NumCorrectionsReceived, LastCorrectionsReceived) / SampleTime);
+		DashMispredictionRateGraph.AddSample(Delta(ClientData->NumDashMispredictions, LastDashMispredictions) / SampleTime);
+		LastCorrectionError = ClientData->LastCorrectionError;
+		TotalCorrections = ClientData->NumCorrectionsReceived;
+		TotalDashMispredictions = ClientData->NumDashMispredictions;
+	}
+	else
+	{
+		PendingMovesGraph.AddSample(0.f);
+		ServerMoveRateGraph.AddSample(0.f);
+		CorrectionRateGraph.AddSample(0.f);
+		DashMispredictionRateGraph.AddSample(0.f);
+	}
+}
 
 void AMovementPredictionHUD::DrawHUD()
 {
@@ -32,4 +184,58 @@ void AMovementPredictionHUD::DrawHUD()
 	FCanvasTileItem TileItem( CrosshairDrawPosition, CrosshairTex->Resource, FLinearColor::White);
 	TileItem.BlendMode = SE_BLEND_Translucent;
 	Canvas->DrawItem( TileItem );
+
+	if (CVarNetOverlay.GetValueOnGameThread() != 0)
+	{
+		DrawNetOverlay();
+	}
+}
+
+void AMovementPredictionHUD::DrawNetOverlay()
+{
+	// Top right, clear of the on screen debug messages
+	const float X = Canvas->ClipX - NetOverlayGraphWidth - NetOverlayMargin;
+	float Y = NetOverlayMargin;
+
+	Canvas->SetDrawColor(bPredicting ? FColor::Green : FColor::Red);
+	Canvas->DrawText(GEngine->GetSmallFont(), bPredicting ? TEXT("Prediction ON") : TEXT("Prediction OFF"), X, Y);
+	Y += NetOverlayLabelHeight + 4.f;
+
+	const float GraphSpacing = NetOverlayLabelHeight + NetOverlayGraphHeight + 4.f;
+	DrawNetOverlayGraph(RttGraph, X, Y, FString());
+	DrawNetOverlayGraph(JitterGraph, X, Y += GraphSpacing, FString());
+	DrawNetOverlayGraph(PendingMovesGraph, X, Y += GraphSpacing, FString());
+	DrawNetOverlayGraph(ServerMoveRateGraph, X, Y += GraphSpacing, FString());
+	DrawNetOverlayGraph(OutBytesGraph, X, Y += GraphSpacing, FString());
+	DrawNetOverlayGraph(InBytesGraph, X, Y += GraphSpacing, FString());
+	DrawNetOverlayGraph(CorrectionRateGraph, X, Y += GraphSpacing, FString::Printf(TEXT("(%u, last %.1f uu)"), TotalCorrections, LastCorrectionError));
+	DrawNetOverlayGraph(DashMispredictionRateGraph, X, Y += GraphSpacing, FString::Printf(TEXT("(%u)"), TotalDashMispredictions));
+}
+
+void AMovementPredictionHUD::DrawNetOverlayGraph(const FNetOverlayGraph& Graph, float X, float Y, const FString& Extra)
+{
+	// Scaled to the largest sample in view, with a floor so an idle graph doesn't turn noise into spikes
+	const float Max = FMath::Max(Graph.GetMax(), 1.f);
+
+	Canvas->SetDrawColor(Graph.Color.ToFColor(true));
+	Canvas->DrawText(GEngine->GetTinyFont(), FString::Printf(TEXT("%s %.1f%s (max %.1f) %s"), Graph.Label, Graph.GetLatest(), Graph.Unit, Max, *Extra), X, Y);
+	Y += NetOverlayLabelHeight;
+
+	FCanvasTileItem Background(FVector2D(X, Y), FVector2D(NetOverlayGraphWidth, NetOverlayGraphHeight), FLinearColor(0.f, 0.f, 0.f, 0.5f));
+	Background.BlendMode = SE_BLEND_Translucent;
+	Canvas->DrawItem(Background);
+
+	// Straight into one batch of lines, oldest sample on the left
+	FBatchedElements* Lines = Canvas->Canvas->GetBatchedElements(FCanvas::ET_Line);
+	const int32 NumSamples = Graph.Samples.Num();
+	const float Step = NetOverlayGraphWidth / (NumSamples - 1);
+	const float Bottom = Y + NetOverlayGraphHeight;
+	FVector Previous(X, Bottom - Graph.Samples[Graph.NextSample] / Max * NetOverlayGraphHeight, 0.f);
+	for (int32 Index = 1; Index < NumSamples; ++Index)
+	{
+		const float Sample = Graph.Samples[(Graph.NextSample + Index) % NumSamples];
+		const FVector Current(X + Index * Step, Bottom - Sample / Max * NetOverlayGraphHeight, 0.f);
+		Lines->AddLine(Previous, Current, Graph.Color, FHitProxyId());
+		Previous = Current;
+	}
 }
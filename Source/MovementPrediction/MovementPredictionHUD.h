@@ -6,6 +6,29 @@
 #include "GameFramework/HUD.h"
 #include "MovementPredictionHUD.generated.h"
 
+/** Rolling history of one value on the net overlay, sized once so sampling and drawing never allocate */
+struct FNetOverlayGraph
+{
+	FNetOverlayGraph(const TCHAR* InLabel, const TCHAR* InUnit, const FLinearColor& InColor);
+
+	/** Throws away the history and makes room for NumSamples */
+	void Reset(int32 NumSamples);
+
+	/** Overwrites the oldest sample */
+	void AddSample(float Value);
+
+	float GetLatest() const;
+	float GetMax() const;
+
+	const TCHAR* Label;
+	const TCHAR* Unit;
+	FLinearColor Color;
+
+	// Ring buffer, NextSample is the oldest
+	TArray<float> Samples;
+	int32 NextSample;
+};
+
 UCLASS()
 class AMovementPredictionHUD : public AHUD
 {
@@ -14,12 +37,62 @@ class AMovementPredictionHUD : public AHUD
 public:
 	AMovementPredictionHUD();
 
+	// Begin AActor Interface
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End AActor Interface
+
 	/** Primary draw call for the HUD */
 	virtual void DrawHUD() override;
 
+	/** Shows or hides the net overlay, see mp.NetOverlay */
+	static void ToggleNetOverlay();
+
+protected:
+
+	/** How often the net overlay takes a sample, in seconds */
+	UPROPERTY(EditDefaultsOnly, Category = "Net Overlay")
+	float NetOverlaySampleInterval;
+
+	/** How many samples each net overlay graph keeps */
+	UPROPERTY(EditDefaultsOnly, Category = "Net Overlay")
+	int32 NetOverlayNumSamples;
+
 private:
 	/** Crosshair asset pointer */
 	class UTexture2D* CrosshairTex;
 
+	/** Reads the local player's connection and movement counters into the graphs */
+	void SampleNetOverlay(float SampleTime);
+
+	void DrawNetOverlay();
+
+	/** Draws one graph with its top left at X, Y, labelled with its latest value and Extra */
+	void DrawNetOverlayGraph(const FNetOverlayGraph& Graph, float X, float Y, const FString& Extra);
+
+	FNetOverlayGraph RttGraph;
+	FNetOverlayGraph JitterGraph;
+	FNetOverlayGraph PendingMovesGraph;
+	FNetOverlayGraph ServerMoveRateGraph;
+	FNetOverlayGraph OutBytesGraph;
+	FNetOverlayGraph InBytesGraph;
+	FNetOverlayGraph CorrectionRateGraph;
+	FNetOverlayGraph DashMispredictionRateGraph;
+
+	// Time since the last sample
+	float NetOverlaySampleTimer;
+
+	// Client prediction counters at the last sample, the graphs show how fast they're going up
+	uint32 LastServerMovesSent;
+	uint32 LastCorrectionsReceived;
+	uint32 LastDashMispredictions;
+
+	// Latest correction error, and the totals since the local character's prediction data was created
+	float LastCorrectionError;
+	uint32 TotalCorrections;
+	uint32 TotalDashMispredictions;
+
+	// If the local character was predicting at the last sample
+	uint8 bPredicting : 1;
 };
 
@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementPredictionLagCompensation.h"
+#include "MovementPrediction.h"
+#include "MovementPredictionCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLagCompensation, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_MovementPrediction_LagCompensationRecord, STATGROUP_MovementPrediction);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Query"), STAT_MovementPrediction_LagCompensationQuery, STATGROUP_MovementPrediction);
+DECLARE_MEMORY_STAT(TEXT("Lag Compensation History"), STAT_MovementPrediction_LagCompensationMemory, STATGROUP_MovementPrediction);
+
+static void LagCompBench(const TArray<FString>& Args)
+{
+	const int32 NumCharacters = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100;
+	const int32 NumQueries = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 10000;
+	const int32 NumFrames = Args.Num() > 2 ? FMath::Max(FCString::Atoi(*Args[2]), 1) : 600;
+	UMovementPredictionLagCompensation::RunBenchmark(NumCharacters, NumQueries, NumFrames);
+}
+
+static FAutoConsoleCommandWithArgs LagCompBenchCommand(
+	TEXT("mp.LagCompBench"),
+	TEXT("mp.LagCompBench [characters=100] [queries=10000] [frames=600] times recording and rewound line traces on synthetic characters"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&LagCompBench));
+
+UMovementPredictionLagCompensation::UMovementPredictionLagCompensation()
+{
+	HistorySeconds = 1.f;
+	MaxTickRate = 120.f;
+}
+
+void UMovementPredictionLagCompensation::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const int32 NumFrames = FMath::CeilToInt(FMath::Max(HistorySeconds, 0.1f) * FMath::Max(MaxTickRate, 1.f)) + 1;
+	History = MakeUnique<FLagCompensationHistory>(NumFrames, 16);
+	SlotCharacters.SetNum(16);
+
+	INC_MEMORY_STAT_BY(STAT_MovementPrediction_LagCompensationMemory, History->GetAllocatedSize());
+}
+
+void UMovementPredictionLagCompensation::Deinitialize()
+{
+	if (History)
+	{
+		DEC_MEMORY_STAT_BY(STAT_MovementPrediction_LagCompensationMemory, History->GetAllocatedSize());
+		History.Reset();
+	}
+	SlotCharacters.Reset();
+
+	Super::Deinitialize();
+}
+
+TStatId UMovementPredictionLagCompensation::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMovementPredictionLagCompensation, STATGROUP_Tickables);
+}
+
+UWorld* UMovementPredictionLagCompensation::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UMovementPredictionLagCompensation::IsTickable() const
+{
+	// Only the server checks hits, clients never register anyone
+	return !IsTemplate() && History.IsValid() && SlotCharacters.ContainsByPredicate([](const TWeakObjectPtr<AMovementPredictionCharacter>& Character) { return Character.IsValid(); });
+}
+
+void UMovementPredictionLagCompensation::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_LagCompensationRecord);
+
+	History->BeginFrame(GetWorld()->GetTimeSeconds());
+	for (int32 Slot = 0; Slot < SlotCharacters.Num(); ++Slot)
+	{
+		if (const AMovementPredictionCharacter* Character = SlotCharacters[Slot].Get())
+		{
+			History->SetSlotLocation(Slot, Character->GetCapsuleComponent()->GetComponentLocation());
+		}
+	}
+}
+
+void UMovementPredictionLagCompensation::RegisterCharacter(AMovementPredictionCharacter* Character)
+{
+	if (!History || !Character || SlotCharacters.Contains(Character))
+	{
+		return;
+	}
+
+	DEC_MEMORY_STAT_BY(STAT_MovementPrediction_LagCompensationMemory, History->GetAllocatedSize());
+
+	float Radius, HalfHeight;
+	Character->GetCapsuleComponent()->GetScaledCapsuleSize(Radius, HalfHeight);
+	const int32 Slot = History->AddSlot(Radius, HalfHeight);
+	if (Slot >= SlotCharacters.Num())
+	{
+		SlotCharacters.SetNum(Slot + 1);
+	}
+	SlotCharacters[Slot] = Character;
+
+	INC_MEMORY_STAT_BY(STAT_MovementPrediction_LagCompensationMemory, History->GetAllocatedSize());
+}
+
+void UMovementPredictionLagCompensation::UnregisterCharacter(AMovementPredictionCharacter* Character)
+{
+	const int32 Slot = SlotCharacters.IndexOfByKey(Character);
+	if (History && Slot != INDEX_NONE)
+	{
+		History->RemoveSlot(Slot);
+		SlotCharacters[Slot] = nullptr;
+	}
+}
+
+AMovementPredictionCharacter* UMovementPredictionLagCompensation::SweepRewound(float Time, const FVector& Start, const FVector& End, float Radius, FLagCompensationHit& OutHit, const AMovementPredictionCharacter* IgnoreCharacter) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_LagCompensationQuery);
+
+	if (!History)
+	{
+		return nullptr;
+	}
+
+	const int32 IgnoreSlot = IgnoreCharacter ? SlotCharacters.IndexOfByKey(IgnoreCharacter) : INDEX_NONE;
+	if (!History->SweepAt(Time, Start, End, Radius, OutHit, IgnoreSlot))
+	{
+		return nullptr;
+	}
+
+	return SlotCharacters[OutHit.Slot].Get();
+}
+
+bool UMovementPredictionLagCompensation::GetRewoundLocation(const AMovementPredictionCharacter* Character, float Time, FVector& OutLocation) const
+{
+	const int32 Slot = SlotCharacters.IndexOfByKey(Character);
+	return History && Slot != INDEX_NONE && History->GetLocationAt(Slot, Time, OutLocation);
+}
+
+float UMovementPredictionLagCompensation::GetShooterViewTime(const AController* Shooter) const
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	const APlayerState* PlayerState = Shooter ? Shooter->PlayerState : nullptr;
+	if (!PlayerState || !History || History->GetNumRecordedFrames() == 0)
+	{
+		return Now;
+	}
+
+	// The shot took half the round trip to get here, and the shooter saw the world half a round trip late
+	return FMath::Clamp(Now - PlayerState->ExactPing * 0.001f, History->GetOldestTime(), History->GetNewestTime());
+}
+
+void UMovementPredictionLagCompensation::RunBenchmark(int32 NumCharacters, int32 NumQueries, int32 NumFrames)
+{
+	const float DeltaTime = 1.f / 60.f;
+	const int32 HistoryFrames = FMath::CeilToInt(1.f / DeltaTime) + 1;
+
+	FLagCompensationHistory BenchHistory(HistoryFrames, NumCharacters);
+	FRandomStream Random(1234);
+
+	// Characters wander around a 100m square
+	TArray<FVector> Locations;
+	TArray<FVector> Velocities;
+	for (int32 Index = 0; Index < NumCharacters; ++Index)
+	{
+		BenchHistory.AddSlot(55.f, 96.f);
+		Locations.Add(FVector(Random.FRandRange(-5000.f, 5000.f), Random.FRandRange(-5000.f, 5000.f), 96.f));
+		Velocities.Add(FVector(Random.GetUnitVector().GetSafeNormal2D() * 600.f));
+	}
+
+	float Time = 0.f;
+	uint64 RecordCycles = 0;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		Time += DeltaTime;
+		for (int32 Index = 0; Index < NumCharacters; ++Index)
+		{
+			Locations[Index] += Velocities[Index] * DeltaTime;
+			if (FMath::Abs(Locations[Index].X) > 5000.f || FMath::Abs(Locations[Index].Y) > 5000.f)
+			{
+				Velocities[Index] = -Velocities[Index];
+			}
+		}
+
+		// Only recording is timed, as it would be in Tick
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		BenchHistory.BeginFrame(Time);
+		for (int32 Index = 0; Index < NumCharacters; ++Index)
+		{
+			BenchHistory.SetSlotLocation(Index, Locations[Index]);
+		}
+		RecordCycles += FPlatformTime::Cycles64() - StartCycles;
+	}
+
+	// Shots from one character's eyes toward another, seen up to 250ms ago
+	int32 NumHits = 0;
+	FLagCompensationHit Hit;
+	const uint64 QueryStartCycles = FPlatformTime::Cycles64();
+	for (int32 Query = 0; Query < NumQueries; ++Query)
+	{
+		const int32 Shooter = Random.RandHelper(NumCharacters);
+		const int32 Target = Random.RandHelper(NumCharacters);
+		const FVector Start = Locations[Shooter] + FVector(0.f, 0.f, 64.f);
+		const FVector End = Start + (Locations[Target] - Start).GetSafeNormal() * 10000.f;
+		NumHits += BenchHistory.SweepAt(Time - Random.FRandRange(0.f, 0.25f), Start, End, 0.f, Hit, Shooter) ? 1 : 0;
+	}
+	const uint64 QueryCycles = FPlatformTime::Cycles64() - QueryStartCycles;
+
+	const double RecordUs = FPlatformTime::ToMilliseconds64(RecordCycles) * 1000.0 / NumFrames;
+	const double QueryUs = FPlatformTime::ToMilliseconds64(QueryCycles) * 1000.0 / NumQueries;
+	UE_LOG(LogLagCompensation, Display, TEXT("%d characters, %d frames of history (%.1f KB)"), NumCharacters, HistoryFrames, BenchHistory.GetAllocatedSize() / 1024.f);
+	UE_LOG(LogLagCompensation, Display, TEXT("  record: %.3f us/tick over %d ticks"), RecordUs, NumFrames);
+	UE_LOG(LogLagCompensation, Display, TEXT("  query:  %.3f us/line trace over %d traces, %d hit"), QueryUs, NumQueries, NumHits);
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "LagCompensationHistory.h"
+#include "MovementPredictionLagCompensation.generated.h"
+
+class AController;
+class AMovementPredictionCharacter;
+
+/**
+ * Server record of where every character's capsule was over the last HistorySeconds, so hits can be checked against
+ * what a shooter saw rather than where everyone is now. Queries rewind copies of the capsules, the characters never move.
+ */
+UCLASS(config=Game)
+class UMovementPredictionLagCompensation : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UMovementPredictionLagCompensation();
+
+	// Begin USubsystem Interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End USubsystem Interface
+
+	// Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End FTickableGameObject Interface
+
+	/** Starts recording Character's capsule, from the next server tick */
+	void RegisterCharacter(AMovementPredictionCharacter* Character);
+
+	void UnregisterCharacter(AMovementPredictionCharacter* Character);
+
+	/**
+	 * Sweeps a sphere of Radius (0 for a line) against every character's capsule as it was at Time, in server world seconds.
+	 * Returns the nearest character hit, nullptr for none.
+	 */
+	AMovementPredictionCharacter* SweepRewound(float Time, const FVector& Start, const FVector& End, float Radius, FLagCompensationHit& OutHit, const AMovementPredictionCharacter* IgnoreCharacter = nullptr) const;
+
+	AMovementPredictionCharacter* LineTraceRewound(float Time, const FVector& Start, const FVector& End, FLagCompensationHit& OutHit, const AMovementPredictionCharacter* IgnoreCharacter = nullptr) const
+	{
+		return SweepRewound(Time, Start, End, 0.f, OutHit, IgnoreCharacter);
+	}
+
+	/** Where Character's capsule was at Time */
+	bool GetRewoundLocation(const AMovementPredictionCharacter* Character, float Time, FVector& OutLocation) const;
+
+	/** The time the world was at on Shooter's screen when its shot reached us, clamped to the recorded history */
+	float GetShooterViewTime(const AController* Shooter) const;
+
+	/** Runs the record and query benchmark on synthetic capsules, for mp.LagCompBench */
+	static void RunBenchmark(int32 NumCharacters, int32 NumQueries, int32 NumFrames);
+
+protected:
+
+	/** How far back the history goes, shots from clients with more latency than this are checked against the oldest frame */
+	UPROPERTY(config)
+	float HistorySeconds;
+
+	/** Highest server tick rate the history is sized for */
+	UPROPERTY(config)
+	float MaxTickRate;
+
+private:
+
+	/** Slot in History to character, null for free slots */
+	TArray<TWeakObjectPtr<AMovementPredictionCharacter>> SlotCharacters;
+
+	TUniquePtr<FLagCompensationHistory> History;
+};
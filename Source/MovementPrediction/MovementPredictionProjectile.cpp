@@ -1,6 +1,7 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "MovementPredictionProjectile.h"
+#include "MovementPredictionProjectilePool.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/SphereComponent.h"
 
@@ -29,6 +30,10 @@ AMovementPredictionProjectile::AMovementPredictionProjectile()
 
 	// Die after 3 seconds by default
 	InitialLifeSpan = 3.0f;
+
+	bPooled = false;
+	bInPool = false;
+	LaunchCount = 0;
 }
 
 void AMovementPredictionProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
@@ -38,6 +43,70 @@ void AMovementPredictionProjectile::OnHit(UPrimitiveComponent* HitComp, AActor*
 	{
 		OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
 
+		Recycle();
+	}
+}
+
+void AMovementPredictionProjectile::LifeSpanExpired()
+{
+	Recycle();
+}
+
+void AMovementPredictionProjectile::Recycle()
+{
+	UMovementPredictionProjectilePool* Pool = GetWorld() ? GetWorld()->GetSubsystem<UMovementPredictionProjectilePool>() : nullptr;
+	if (Pool)
+	{
+		Pool->Release(this);
+	}
+	else
+	{
 		Destroy();
 	}
-}
\ No newline at end of file
+}
+
+void AMovementPredictionProjectile::LaunchFromPool(const FVector& Location, const FRotator& Rotation)
+{
+	bInPool = false;
+	LaunchCount++;
+
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// Same velocity InitializeComponent gives a freshly spawned one, StopSimulating may have cleared the updated component
+	ProjectileMovement->SetUpdatedComponent(CollisionComp);
+	ProjectileMovement->Velocity = Rotation.Vector() * ProjectileMovement->InitialSpeed;
+	ProjectileMovement->UpdateComponentVelocity();
+	ProjectileMovement->Activate(true);
+
+	SetLifeSpan(InitialLifeSpan);
+}
+
+void AMovementPredictionProjectile::ReturnToPool()
+{
+	bInPool = true;
+
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+
+	// Clears the lifespan timer
+	SetLifeSpan(0.f);
+}
+
+void AMovementPredictionProjectile::FastForward(float Seconds)
+{
+	SetLifeSpan(FMath::Max(GetLifeSpan() - Seconds, KINDA_SMALL_NUMBER));
+
+	// Same steps a 60 Hz tick would take, so it sweeps and bounces like it had been flying all along
+	const float MaxStep = 1.f / 60.f;
+	while (Seconds > KINDA_SMALL_NUMBER && !bInPool && !ProjectileMovement->HasStoppedSimulation())
+	{
+		const float Step = FMath::Min(Seconds, MaxStep);
+		ProjectileMovement->TickComponent(Step, LEVELTICK_All, nullptr);
+		Seconds -= Step;
+	}
+}
@@ -26,9 +26,39 @@ public:
 	UFUNCTION()
 	void OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 
+	/** Goes back to the projectile pool instead of being destroyed */
+	virtual void LifeSpanExpired() override;
+
+	/** Starts flying from Location along Rotation, as if it was just spawned there */
+	void LaunchFromPool(const FVector& Location, const FRotator& Rotation);
+
+	/** Hides and stops the projectile while it waits in the pool */
+	void ReturnToPool();
+
+	/** Simulates Seconds of flight right away, for shots fired that long ago somewhere else */
+	void FastForward(float Seconds);
+
+	/** Goes up each launch from the pool, tells a reused projectile apart from the shot it was before */
+	uint32 GetLaunchCount() const { return LaunchCount; }
+
 	/** Returns CollisionComp subobject **/
 	FORCEINLINE class USphereComponent* GetCollisionComp() const { return CollisionComp; }
 	/** Returns ProjectileMovement subobject **/
 	FORCEINLINE class UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovement; }
+
+private:
+
+	friend class UMovementPredictionProjectilePool;
+
+	/** Finished with and put back into the projectile pool */
+	void Recycle();
+
+	/** Counted by the projectile pool */
+	uint8 bPooled : 1;
+
+	/** Waiting in the projectile pool */
+	uint8 bInPool : 1;
+
+	uint32 LaunchCount;
 };
 
@@ -0,0 +1,362 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementPredictionProjectileManager.h"
+#include "MovementPrediction.h"
+#include "MovementPredictionProjectile.h"
+#include "MovementPredictionProjectilePool.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SphereComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Batched Projectiles"), STAT_MovementPrediction_BatchedProjectiles, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Projectiles In Flight"), STAT_MovementPrediction_BatchedProjectilesInFlight, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Projectiles Promoted"), STAT_MovementPrediction_BatchedProjectilesPromoted, STATGROUP_MovementPrediction);
+
+static TAutoConsoleVariable<int32> CVarBatchedProjectiles(
+	TEXT("mp.BatchedProjectiles"),
+	0,
+	TEXT("How fired projectiles are simulated.\n")
+	TEXT("0: one pooled actor with its own ProjectileMovementComponent each (default)\n")
+	TEXT("1: batched by UMovementPredictionProjectileManager, promoted to actors only to hit physics bodies"),
+	ECVF_Default);
+
+UMovementPredictionProjectileManager::UMovementPredictionProjectileManager()
+{
+	ProjectileMesh = FSoftObjectPath(TEXT("/Game/FirstPerson/Meshes/FirstPersonProjectileMesh.FirstPersonProjectileMesh"));
+	ProjectileMeshScale = 0.06f;
+	MaxProjectiles = 4096;
+
+	InstanceComponent = nullptr;
+}
+
+void UMovementPredictionProjectileManager::Deinitialize()
+{
+	if (InstanceComponent)
+	{
+		InstanceComponent->DestroyComponent();
+		InstanceComponent = nullptr;
+	}
+
+	while (PosX.Num() > 0)
+	{
+		RemoveProjectile(PosX.Num() - 1);
+	}
+
+	Super::Deinitialize();
+}
+
+bool UMovementPredictionProjectileManager::IsEnabled()
+{
+	return CVarBatchedProjectiles.GetValueOnGameThread() != 0;
+}
+
+TStatId UMovementPredictionProjectileManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMovementPredictionProjectileManager, STATGROUP_Tickables);
+}
+
+UWorld* UMovementPredictionProjectileManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UMovementPredictionProjectileManager::IsTickable() const
+{
+	return !IsTemplate() && PosX.Num() > 0;
+}
+
+int32 UMovementPredictionProjectileManager::FindOrAddClassInfo(UClass* Class)
+{
+	const int32 ExistingIndex = ClassInfos.IndexOfByPredicate([Class](const FProjectileClassInfo& Info) { return Info.Class == Class; });
+	if (ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	// Indices are stored per projectile as a byte
+	if (ClassInfos.Num() > MAX_uint8)
+	{
+		return INDEX_NONE;
+	}
+
+	const AMovementPredictionProjectile* ProjectileCDO = Class->GetDefaultObject<AMovementPredictionProjectile>();
+	const UProjectileMovementComponent* ProjectileMovement = ProjectileCDO->GetProjectileMovement();
+	const USphereComponent* CollisionComp = ProjectileCDO->GetCollisionComp();
+
+	FProjectileClassInfo Info;
+	Info.Class = Class;
+	Info.GravityZ = GetWorld()->GetGravityZ() * ProjectileMovement->ProjectileGravityScale;
+	Info.Bounciness = ProjectileMovement->Bounciness;
+	Info.Friction = ProjectileMovement->Friction;
+	Info.StopSpeed = ProjectileMovement->BounceVelocityStopSimulatingThreshold;
+	Info.Radius = CollisionComp->GetUnscaledSphereRadius();
+	Info.LifeSpan = ProjectileCDO->InitialLifeSpan > 0.f ? ProjectileCDO->InitialLifeSpan : 3.f;
+	Info.bShouldBounce = ProjectileMovement->bShouldBounce;
+	Info.ObjectType = CollisionComp->GetCollisionObjectType();
+	Info.ResponseParams = FCollisionResponseParams(CollisionComp->GetCollisionResponseToChannels());
+
+	return ClassInfos.Add(Info);
+}
+
+bool UMovementPredictionProjectileManager::Launch(TSubclassOf<AMovementPredictionProjectile> Class, const FVector& Location, const FRotator& Rotation)
+{
+	if (!Class || PosX.Num() >= MaxProjectiles)
+	{
+		return false;
+	}
+
+	const int32 ClassIndex = FindOrAddClassInfo(Class);
+	if (ClassIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	LLM_SCOPE_MOVEMENTPREDICTION(Projectiles);
+
+	const FProjectileClassInfo& Info = ClassInfos[ClassIndex];
+	const FVector Velocity = Rotation.Vector() * Class->GetDefaultObject<AMovementPredictionProjectile>()->GetProjectileMovement()->InitialSpeed;
+
+	PosX.Add(Location.X);
+	PosY.Add(Location.Y);
+	PosZ.Add(Location.Z);
+	VelX.Add(Velocity.X);
+	VelY.Add(Velocity.Y);
+	VelZ.Add(Velocity.Z);
+	AccelZ.Add(Info.GravityZ);
+	LifeRemaining.Add(Info.LifeSpan);
+	ClassIndices.Add((uint8)ClassIndex);
+	PendingTraces.AddDefaulted();
+
+	// Nothing to draw with on dedicated servers
+	if (!InstanceComponent && !IsRunningDedicatedServer())
+	{
+		if (UStaticMesh* Mesh = Cast<UStaticMesh>(ProjectileMesh.TryLoad()))
+		{
+			InstanceComponent = NewObject<UInstancedStaticMeshComponent>(this, TEXT("BatchedProjectiles"));
+			InstanceComponent->SetStaticMesh(Mesh);
+			InstanceComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			InstanceComponent->SetMobility(EComponentMobility::Movable);
+			InstanceComponent->SetCastShadow(false);
+			InstanceComponent->RegisterComponentWithWorld(GetWorld());
+		}
+	}
+
+	return true;
+}
+
+void UMovementPredictionProjectileManager::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_BatchedProjectiles);
+	CSV_SCOPED_TIMING_STAT(MovementPrediction, BatchedProjectiles);
+
+	ResolveTraces();
+	Integrate(DeltaTime);
+	IssueTraces(DeltaTime);
+	UpdateInstances();
+
+	INC_DWORD_STAT_BY(STAT_MovementPrediction_BatchedProjectilesInFlight, PosX.Num());
+	CSV_CUSTOM_STAT(MovementPrediction, BatchedProjectilesInFlight, PosX.Num(), ECsvCustomStatOp::Set);
+}
+
+void UMovementPredictionProjectileManager::ResolveTraces()
+{
+	UWorld* World = GetWorld();
+
+	// Backwards, so the projectile swapped in by a removal has already been looked at
+	for (int32 Index = PendingTraces.Num() - 1; Index >= 0; --Index)
+	{
+		if (!PendingTraces[Index].IsValid())
+		{
+			continue;
+		}
+
+		FTraceDatum TraceData;
+		const bool bHaveData = World->QueryTraceData(PendingTraces[Index], TraceData);
+		PendingTraces[Index] = FTraceHandle();
+
+		const FHitResult* Hit = bHaveData ? FHitResult::GetFirstBlockingHit(TraceData.OutHits) : nullptr;
+		if (!Hit)
+		{
+			continue;
+		}
+
+		// Same rule as OnHit, only physics bodies get pushed and that needs a real projectile
+		UPrimitiveComponent* HitComponent = Hit->Component.Get();
+		if (HitComponent && HitComponent->IsSimulatingPhysics())
+		{
+			Promote(Index, *Hit);
+			RemoveProjectile(Index);
+			continue;
+		}
+
+		const FProjectileClassInfo& Info = ClassInfos[ClassIndices[Index]];
+
+		// Back to where the sweep stopped, we've been past it for a frame
+		const FVector Location = Hit->bStartPenetrating ? Hit->TraceStart + Hit->Normal * (Hit->PenetrationDepth + KINDA_SMALL_NUMBER) : Hit->Location + Hit->Normal * KINDA_SMALL_NUMBER;
+		PosX[Index] = Location.X;
+		PosY[Index] = Location.Y;
+		PosZ[Index] = Location.Z;
+
+		FVector Velocity(VelX[Index], VelY[Index], VelZ[Index]);
+		if (Info.bShouldBounce)
+		{
+			// Same as UProjectileMovementComponent::ComputeBounceDelta without bBounceAngleAffectsFriction
+			const float VDotNormal = Velocity | Hit->Normal;
+			if (VDotNormal < 0.f)
+			{
+				const FVector ProjectedNormal = Hit->Normal * -VDotNormal;
+				Velocity += ProjectedNormal;
+				Velocity *= FMath::Clamp(1.f - Info.Friction, 0.f, 1.f);
+				Velocity += ProjectedNormal * FMath::Max(Info.Bounciness, 0.f);
+			}
+		}
+
+		// Rests where it is for the rest of its life, like the component stopping its simulation
+		if (!Info.bShouldBounce || Velocity.SizeSquared() < FMath::Square(Info.StopSpeed))
+		{
+			Velocity = FVector::ZeroVector;
+			AccelZ[Index] = 0.f;
+		}
+
+		VelX[Index] = Velocity.X;
+		VelY[Index] = Velocity.Y;
+		VelZ[Index] = Velocity.Z;
+	}
+}
+
+void UMovementPredictionProjectileManager::Integrate(float DeltaTime)
+{
+	const int32 NumProjectiles = PosX.Num();
+
+	// Straight loops over plain float arrays, left for the compiler to vectorize
+	float* RESTRICT VelZData = VelZ.GetData();
+	const float* RESTRICT AccelZData = AccelZ.GetData();
+	for (int32 Index = 0; Index < NumProjectiles; ++Index)
+	{
+		VelZData[Index] += AccelZData[Index] * DeltaTime;
+	}
+
+	float* RESTRICT PosXData = PosX.GetData();
+	float* RESTRICT PosYData = PosY.GetData();
+	float* RESTRICT PosZData = PosZ.GetData();
+	const float* RESTRICT VelXData = VelX.GetData();
+	const float* RESTRICT VelYData = VelY.GetData();
+	for (int32 Index = 0; Index < NumProjectiles; ++Index)
+	{
+		PosXData[Index] += VelXData[Index] * DeltaTime;
+		PosYData[Index] += VelYData[Index] * DeltaTime;
+		PosZData[Index] += VelZData[Index] * DeltaTime;
+	}
+
+	float* RESTRICT LifeData = LifeRemaining.GetData();
+	for (int32 Index = 0; Index < NumProjectiles; ++Index)
+	{
+		LifeData[Index] -= DeltaTime;
+	}
+
+	for (int32 Index = NumProjectiles - 1; Index >= 0; --Index)
+	{
+		if (LifeRemaining[Index] <= 0.f)
+		{
+			RemoveProjectile(Index);
+		}
+	}
+}
+
+void UMovementPredictionProjectileManager::IssueTraces(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+
+	static const FName BatchedProjectileTraceName(TEXT("BatchedProjectile"));
+	const FCollisionQueryParams QueryParams(BatchedProjectileTraceName, false);
+
+	for (int32 Index = 0; Index < PosX.Num(); ++Index)
+	{
+		const FVector Velocity(VelX[Index], VelY[Index], VelZ[Index]);
+		if (Velocity.IsZero())
+		{
+			continue;
+		}
+
+		const FProjectileClassInfo& Info = ClassInfos[ClassIndices[Index]];
+		const FVector End(PosX[Index], PosY[Index], PosZ[Index]);
+		const FVector Start = End - Velocity * DeltaTime;
+
+		PendingTraces[Index] = World->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, FQuat::Identity, Info.ObjectType,
+			FCollisionShape::MakeSphere(Info.Radius), QueryParams, Info.ResponseParams);
+	}
+}
+
+void UMovementPredictionProjectileManager::UpdateInstances()
+{
+	if (!InstanceComponent)
+	{
+		return;
+	}
+
+	const int32 NumProjectiles = PosX.Num();
+	while (InstanceComponent->GetInstanceCount() > NumProjectiles)
+	{
+		InstanceComponent->RemoveInstance(InstanceComponent->GetInstanceCount() - 1);
+	}
+
+	const FVector Scale(ProjectileMeshScale);
+	while (InstanceComponent->GetInstanceCount() < NumProjectiles)
+	{
+		InstanceComponent->AddInstance(FTransform(FQuat::Identity, FVector::ZeroVector, Scale));
+	}
+
+	if (NumProjectiles == 0)
+	{
+		return;
+	}
+
+	InstanceTransforms.SetNum(NumProjectiles, false);
+	for (int32 Index = 0; Index < NumProjectiles; ++Index)
+	{
+		InstanceTransforms[Index] = FTransform(FQuat::Identity, FVector(PosX[Index], PosY[Index], PosZ[Index]), Scale);
+	}
+
+	InstanceComponent->BatchUpdateInstancesTransforms(0, InstanceTransforms, true, true, true);
+}
+
+void UMovementPredictionProjectileManager::Promote(int32 Index, const FHitResult& Hit)
+{
+	UMovementPredictionProjectilePool* Pool = GetWorld()->GetSubsystem<UMovementPredictionProjectilePool>();
+	if (!Pool)
+	{
+		return;
+	}
+
+	const FProjectileClassInfo& Info = ClassInfos[ClassIndices[Index]];
+	const FVector Velocity(VelX[Index], VelY[Index], VelZ[Index]);
+
+	// Just short of the body so the actor's own sweep hits it next tick and OnHit does the pushing
+	const FVector Location = Hit.Location - Velocity.GetSafeNormal() * Info.Radius;
+	if (AMovementPredictionProjectile* Projectile = Pool->Acquire(Info.Class, Location, Velocity.Rotation()))
+	{
+		Projectile->GetProjectileMovement()->Velocity = Velocity;
+		Projectile->SetLifeSpan(FMath::Max(LifeRemaining[Index], KINDA_SMALL_NUMBER));
+
+		INC_DWORD_STAT(STAT_MovementPrediction_BatchedProjectilesPromoted);
+		CSV_CUSTOM_STAT(MovementPrediction, BatchedProjectilesPromoted, 1, ECsvCustomStatOp::Accumulate);
+	}
+}
+
+void UMovementPredictionProjectileManager::RemoveProjectile(int32 Index)
+{
+	PosX.RemoveAtSwap(Index, 1, false);
+	PosY.RemoveAtSwap(Index, 1, false);
+	PosZ.RemoveAtSwap(Index, 1, false);
+	VelX.RemoveAtSwap(Index, 1, false);
+	VelY.RemoveAtSwap(Index, 1, false);
+	VelZ.RemoveAtSwap(Index, 1, false);
+	AccelZ.RemoveAtSwap(Index, 1, false);
+	LifeRemaining.RemoveAtSwap(Index, 1, false);
+	ClassIndices.RemoveAtSwap(Index, 1, false);
+	PendingTraces.RemoveAtSwap(Index, 1, false);
+}
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+#include "MovementPredictionProjectileManager.generated.h"
+
+class AMovementPredictionProjectile;
+class UInstancedStaticMeshComponent;
+
+/**
+ * Simulates projectiles without an actor each, for when hundreds of bouncing rounds are in flight.
+ *
+ * Position, velocity and lifetime live in flat per-field arrays and get integrated in one pass, collision is one async sweep
+ * per projectile read back the next frame, and every projectile is drawn as an instance of one instanced mesh.
+ * A projectile only becomes a real AMovementPredictionProjectile (from the projectile pool) when it's about to hit a physics body,
+ * so OnHit can push it.
+ *
+ * Off by default, OnFire uses it with mp.BatchedProjectiles 1.
+ */
+UCLASS(config=Game)
+class UMovementPredictionProjectileManager : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UMovementPredictionProjectileManager();
+
+	// Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	// End USubsystem Interface
+
+	// Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End FTickableGameObject Interface
+
+	/** If OnFire should launch into here instead of the projectile pool */
+	static bool IsEnabled();
+
+	/** Launches a projectile with the movement and collision settings of Class' defaults, false if MaxProjectiles are already in flight */
+	bool Launch(TSubclassOf<AMovementPredictionProjectile> Class, const FVector& Location, const FRotator& Rotation);
+
+	int32 GetNumProjectiles() const { return PosX.Num(); }
+
+protected:
+
+	/** Drawn for every projectile, nothing is drawn on dedicated servers */
+	UPROPERTY(config)
+	FSoftObjectPath ProjectileMesh;
+
+	UPROPERTY(config)
+	float ProjectileMeshScale;
+
+	UPROPERTY(config)
+	int32 MaxProjectiles;
+
+private:
+
+	/** Movement and collision settings read from a projectile class' defaults */
+	struct FProjectileClassInfo
+	{
+		UClass* Class;
+		float GravityZ;
+		float Bounciness;
+		float Friction;
+		float StopSpeed;
+		float Radius;
+		float LifeSpan;
+		bool bShouldBounce;
+		ECollisionChannel ObjectType;
+		FCollisionResponseParams ResponseParams;
+	};
+
+	int32 FindOrAddClassInfo(UClass* Class);
+
+	/** Bounces, stops or promotes projectiles whose sweeps from last frame hit something */
+	void ResolveTraces();
+
+	void Integrate(float DeltaTime);
+
+	/** Sweeps this frame's movement, read back by the next ResolveTraces */
+	void IssueTraces(float DeltaTime);
+
+	void UpdateInstances();
+
+	/** Hands a projectile about to hit a physics body over to a real projectile actor */
+	void Promote(int32 Index, const FHitResult& Hit);
+
+	/** Swaps the last projectile into Index */
+	void RemoveProjectile(int32 Index);
+
+	// One entry per projectile in flight, kept apart so Integrate walks each field in order
+	TArray<float> PosX;
+	TArray<float> PosY;
+	TArray<float> PosZ;
+	TArray<float> VelX;
+	TArray<float> VelY;
+	TArray<float> VelZ;
+	TArray<float> AccelZ;
+	TArray<float> LifeRemaining;
+	TArray<uint8> ClassIndices;
+	TArray<FTraceHandle> PendingTraces;
+
+	TArray<FProjectileClassInfo> ClassInfos;
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* InstanceComponent;
+
+	TArray<FTransform> InstanceTransforms;
+};
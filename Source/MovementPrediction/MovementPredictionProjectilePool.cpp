@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementPredictionProjectilePool.h"
+#include "MovementPrediction.h"
+#include "MovementPredictionProjectile.h"
+#include "Engine/World.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogProjectilePool, Log, All);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectile Pool Size"), STAT_MovementPrediction_ProjectilePoolSize, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Hits"), STAT_MovementPrediction_ProjectilePoolHits, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Misses"), STAT_MovementPrediction_ProjectilePoolMisses, STATGROUP_MovementPrediction);
+
+UMovementPredictionProjectilePool::UMovementPredictionProjectilePool()
+{
+	PrewarmCount = 16;
+	MaxPooledPerClass = 128;
+
+	NumAcquired = 0;
+	NumReused = 0;
+	NumInstances = 0;
+	PeakNumInstances = 0;
+}
+
+void UMovementPredictionProjectilePool::Deinitialize()
+{
+	if (NumAcquired > 0)
+	{
+		UE_LOG(LogProjectilePool, Log, TEXT("Projectile pool: %llu shots, %.1f%% reused, peak size %d"),
+			NumAcquired, GetHitRate() * 100.f, PeakNumInstances);
+	}
+
+	// The world destroys the projectiles themselves
+	DEC_DWORD_STAT_BY(STAT_MovementPrediction_ProjectilePoolSize, NumInstances);
+	FreeLists.Empty();
+	NumInstances = 0;
+
+	Super::Deinitialize();
+}
+
+void UMovementPredictionProjectilePool::Prewarm(TSubclassOf<AMovementPredictionProjectile> Class)
+{
+	if (!Class)
+	{
+		return;
+	}
+
+	while (FreeLists.FindOrAdd(Class).Projectiles.Num() < PrewarmCount)
+	{
+		AMovementPredictionProjectile* Projectile = SpawnPooledProjectile(Class);
+		if (!Projectile)
+		{
+			break;
+		}
+
+		FreeLists.FindOrAdd(Class).Projectiles.Add(Projectile);
+	}
+}
+
+AMovementPredictionProjectile* UMovementPredictionProjectilePool::Acquire(TSubclassOf<AMovementPredictionProjectile> Class, const FVector& Location, const FRotator& Rotation)
+{
+	UWorld* World = GetWorld();
+	if (!Class || !World)
+	{
+		return nullptr;
+	}
+
+	// Level streaming or a blueprint may have destroyed some of them behind our back
+	TArray<AMovementPredictionProjectile*>& FreeProjectiles = FreeLists.FindOrAdd(Class).Projectiles;
+	AMovementPredictionProjectile* Projectile = nullptr;
+	while (!Projectile && FreeProjectiles.Num() > 0)
+	{
+		Projectile = FreeProjectiles.Pop(false);
+		if (Projectile->IsPendingKillPending())
+		{
+			Projectile = nullptr;
+			--NumInstances;
+			DEC_DWORD_STAT(STAT_MovementPrediction_ProjectilePoolSize);
+		}
+	}
+
+	NumAcquired++;
+	if (Projectile)
+	{
+		NumReused++;
+		INC_DWORD_STAT(STAT_MovementPrediction_ProjectilePoolHits);
+		CSV_CUSTOM_STAT(MovementPrediction, ProjectilePoolHits, 1, ECsvCustomStatOp::Accumulate);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_MovementPrediction_ProjectilePoolMisses);
+		CSV_CUSTOM_STAT(MovementPrediction, ProjectilePoolMisses, 1, ECsvCustomStatOp::Accumulate);
+
+		Projectile = SpawnPooledProjectile(Class);
+		if (!Projectile)
+		{
+			return nullptr;
+		}
+	}
+
+	Projectile->LaunchFromPool(Location, Rotation);
+
+	// Placement test needs collision, so it comes after the launch
+	FVector AdjustedLocation = Location;
+	if (!World->FindTeleportSpot(Projectile, AdjustedLocation, Rotation))
+	{
+		Release(Projectile);
+		return nullptr;
+	}
+
+	if (!AdjustedLocation.Equals(Location))
+	{
+		Projectile->SetActorLocation(AdjustedLocation, false, nullptr, ETeleportType::ResetPhysics);
+	}
+
+	return Projectile;
+}
+
+void UMovementPredictionProjectilePool::Release(AMovementPredictionProjectile* Projectile)
+{
+	if (!Projectile || Projectile->bInPool)
+	{
+		return;
+	}
+
+	// Spawned by someone else, it's ours now
+	if (!Projectile->bPooled)
+	{
+		Projectile->bPooled = true;
+		++NumInstances;
+		PeakNumInstances = FMath::Max(PeakNumInstances, NumInstances);
+		INC_DWORD_STAT(STAT_MovementPrediction_ProjectilePoolSize);
+	}
+
+	TArray<AMovementPredictionProjectile*>& FreeProjectiles = FreeLists.FindOrAdd(Projectile->GetClass()).Projectiles;
+	if (FreeProjectiles.Num() >= MaxPooledPerClass)
+	{
+		--NumInstances;
+		DEC_DWORD_STAT(STAT_MovementPrediction_ProjectilePoolSize);
+		Projectile->Destroy();
+		return;
+	}
+
+	Projectile->ReturnToPool();
+	FreeProjectiles.Add(Projectile);
+}
+
+AMovementPredictionProjectile* UMovementPredictionProjectilePool::SpawnPooledProjectile(UClass* Class)
+{
+	LLM_SCOPE_MOVEMENTPREDICTION(Projectiles);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AMovementPredictionProjectile* Projectile = GetWorld()->SpawnActor<AMovementPredictionProjectile>(Class, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+	if (!Projectile)
+	{
+		return nullptr;
+	}
+
+	Projectile->bPooled = true;
+	Projectile->ReturnToPool();
+
+	++NumInstances;
+	PeakNumInstances = FMath::Max(PeakNumInstances, NumInstances);
+	INC_DWORD_STAT(STAT_MovementPrediction_ProjectilePoolSize);
+	CSV_CUSTOM_STAT(MovementPrediction, ProjectilePoolSize, NumInstances, ECsvCustomStatOp::Set);
+
+	return Projectile;
+}
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MovementPredictionProjectilePool.generated.h"
+
+class AMovementPredictionProjectile;
+
+USTRUCT()
+struct FMovementPredictionProjectileFreeList
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AMovementPredictionProjectile*> Projectiles;
+};
+
+/**
+ * Reuses projectiles instead of spawning one per shot and destroying it on hit or after its lifespan.
+ * Pooled projectiles stay in the world hidden, without collision and with their movement component deactivated.
+ */
+UCLASS(config=Game)
+class UMovementPredictionProjectilePool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UMovementPredictionProjectilePool();
+
+	// Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	// End USubsystem Interface
+
+	/** Spawns projectiles of Class until at least PrewarmCount of them are waiting in the pool */
+	void Prewarm(TSubclassOf<AMovementPredictionProjectile> Class);
+
+	/**
+	 * Launches a projectile from the pool, spawning one when the pool is empty.
+	 * Like spawning with AdjustIfPossibleButDontSpawnIfColliding, returns nullptr if it can't be placed without overlapping something.
+	 */
+	AMovementPredictionProjectile* Acquire(TSubclassOf<AMovementPredictionProjectile> Class, const FVector& Location, const FRotator& Rotation);
+
+	/** Takes back a projectile that hit something or ran out of life, destroys it if the pool is already full */
+	void Release(AMovementPredictionProjectile* Projectile);
+
+	/** Fraction of Acquire calls served without spawning */
+	float GetHitRate() const { return NumAcquired > 0 ? float(NumReused) / NumAcquired : 0.f; }
+
+	/** Most projectiles the pool had alive at once, in flight or waiting */
+	int32 GetPeakSize() const { return PeakNumInstances; }
+
+	int32 GetNumInstances() const { return NumInstances; }
+
+protected:
+
+	/** Projectiles of each class Prewarm makes sure are waiting */
+	UPROPERTY(config)
+	int32 PrewarmCount;
+
+	/** Projectiles of each class kept waiting, more than that are destroyed when they come back */
+	UPROPERTY(config)
+	int32 MaxPooledPerClass;
+
+private:
+
+	/** Spawns a projectile straight into the pool */
+	AMovementPredictionProjectile* SpawnPooledProjectile(UClass* Class);
+
+	UPROPERTY()
+	TMap<UClass*, FMovementPredictionProjectileFreeList> FreeLists;
+
+	uint64 NumAcquired;
+	uint64 NumReused;
+	int32 NumInstances;
+	int32 PeakNumInstances;
+};
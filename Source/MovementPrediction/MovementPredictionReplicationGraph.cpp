@@ -0,0 +1,255 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementPredictionReplicationGraph.h"
+#include "MovementPredictionCharacter.h"
+#include "MovementPredictionProjectile.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMovementPredictionRepGraph, Log, All);
+
+static TAutoConsoleVariable<int32> CVarUseReplicationGraph(
+	TEXT("mp.ReplicationGraph"),
+	1,
+	TEXT("Which replication path the game net driver uses, read when the net driver is created (next map load or listen).\n")
+	TEXT("0: engine default, every actor checked against every connection\n")
+	TEXT("1: UMovementPredictionReplicationGraph (default)"),
+	ECVF_Default);
+
+// How often moving actors in a grid cell replicate, by where they are relative to the viewer. Zones are checked in order,
+// the first one the actor's view direction dot product reaches wins. Periods are in replication frames and scale from
+// MinRepPeriod at MinDistPct of the actor's cull distance to MaxRepPeriod at MaxDistPct.
+static UReplicationGraphNode_DynamicSpatialFrequency::FSpatializationZone GSpatialFrequencyZones[] =
+{
+	// In front of you
+	UReplicationGraphNode_DynamicSpatialFrequency::FSpatializationZone(0.707f, 0.f, 1.f, 1, 3, 1, 3),
+	// Off to the side
+	UReplicationGraphNode_DynamicSpatialFrequency::FSpatializationZone(0.f, 0.f, 1.f, 1, 5, 1, 5),
+	// Behind you
+	UReplicationGraphNode_DynamicSpatialFrequency::FSpatializationZone(-1.f, 0.f, 1.f, 2, 8, 2, 8),
+};
+
+static UReplicationGraphNode_DynamicSpatialFrequency::FSettings GSpatialFrequencySettings;
+
+UMovementPredictionReplicationGraph::UMovementPredictionReplicationGraph()
+{
+	GridCellSize = 10000.f;
+	GridSpatialBias = FVector2D(-100000.f, -100000.f);
+
+	GridNode = nullptr;
+	AlwaysRelevantNode = nullptr;
+}
+
+void UMovementPredictionReplicationGraph::RegisterReplicationDriver()
+{
+	int32 UseReplicationGraph;
+	if (FParse::Value(FCommandLine::Get(), TEXT("MPRepGraph="), UseReplicationGraph))
+	{
+		CVarUseReplicationGraph->Set(UseReplicationGraph, ECVF_SetByCommandline);
+	}
+
+	UReplicationDriver::CreateReplicationDriverDelegate().BindLambda([](UNetDriver* ForNetDriver, const FURL& URL, UWorld* World) -> UReplicationDriver*
+	{
+		// Demo recording and beacons keep the default path
+		if (ForNetDriver->NetDriverName != NAME_GameNetDriver || CVarUseReplicationGraph.GetValueOnGameThread() == 0)
+		{
+			return nullptr;
+		}
+
+		return NewObject<UMovementPredictionReplicationGraph>(GetTransientPackage());
+	});
+}
+
+uint16 UMovementPredictionReplicationGraph::GetReplicationPeriodFrame(float NetUpdateFrequency) const
+{
+	const float ServerTickRate = NetDriver ? float(NetDriver->NetServerMaxTickRate) : 30.f;
+	return (uint16)FMath::Clamp(FMath::RoundToInt(ServerTickRate / FMath::Max(NetUpdateFrequency, 0.01f)), 1, MAX_uint16);
+}
+
+void UMovementPredictionReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Anything we don't know better about replicates every frame it's relevant, at the default priority
+	GlobalActorReplicationInfoMap.SetClassInfo(AActor::StaticClass(), FClassReplicationInfo());
+
+	// Characters and projectiles keep their own cull distance and update rate. Blueprint subclasses share their native class' settings.
+	auto SetMovingClassInfo = [this](UClass* Class)
+	{
+		const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.DistancePriorityScale = 1.f;
+		ClassInfo.StarvationPriorityScale = 1.f;
+		ClassInfo.CullDistanceSquared = ActorCDO->NetCullDistanceSquared;
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrame(ActorCDO->NetUpdateFrequency);
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	};
+	SetMovingClassInfo(AMovementPredictionCharacter::StaticClass());
+	SetMovingClassInfo(AMovementPredictionProjectile::StaticClass());
+
+	// Names and scores, nobody needs these every frame
+	FClassReplicationInfo PlayerStateInfo;
+	PlayerStateInfo.DistancePriorityScale = 0.f;
+	PlayerStateInfo.ActorChannelFrameTimeout = 0;
+	PlayerStateInfo.ReplicationPeriodFrame = GetReplicationPeriodFrame(2.f);
+	GlobalActorReplicationInfoMap.SetClassInfo(APlayerState::StaticClass(), PlayerStateInfo);
+}
+
+void UMovementPredictionReplicationGraph::InitGlobalGraphNodes()
+{
+	// Grid cells bucket their moving actors by view distance and direction instead of the default load balanced buckets
+	GSpatialFrequencySettings.ZoneSettings = MakeArrayView(GSpatialFrequencyZones);
+	GSpatialFrequencySettings.ZoneSettings_NonFastShared = MakeArrayView(GSpatialFrequencyZones);
+	UReplicationGraphNode_GridCell::CreateDynamicNodeOverride = [](UReplicationGraphNode_GridCell* Parent) -> UReplicationGraphNode*
+	{
+		UReplicationGraphNode_DynamicSpatialFrequency* FrequencyNode = Parent->CreateChildNode<UReplicationGraphNode_DynamicSpatialFrequency>();
+		FrequencyNode->Settings = &GSpatialFrequencySettings;
+		return FrequencyNode;
+	};
+
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = GridSpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UMovementPredictionReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* ConnectionManager)
+{
+	Super::InitConnectionGraphNodes(ConnectionManager);
+
+	UMovementPredictionReplicationGraphNode_OwnerRelevant* OwnerRelevantNode = CreateNewNode<UMovementPredictionReplicationGraphNode_OwnerRelevant>();
+	AddConnectionGraphNode(OwnerRelevantNode, ConnectionManager);
+	OwnerRelevantNodes.Add(OwnerRelevantNode);
+}
+
+void UMovementPredictionReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+
+	if (Actor->bAlwaysRelevant)
+	{
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+	}
+	else if (Actor->bOnlyRelevantToOwner)
+	{
+		// Controllers are picked up by their connection's owner relevant node, nothing else here is owner only
+		if (!Actor->IsA<APlayerController>())
+		{
+			UE_LOG(LogMovementPredictionRepGraph, Warning, TEXT("%s is only relevant to its owner but isn't a player controller, it won't replicate"), *Actor->GetName());
+		}
+	}
+	else if (Actor->IsA<AMovementPredictionCharacter>() || Actor->IsA<AMovementPredictionProjectile>())
+	{
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+	}
+	else
+	{
+		// Static while dormant, moves through the grid while awake
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+	}
+}
+
+void UMovementPredictionReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+
+	if (Actor->bAlwaysRelevant)
+	{
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+	}
+	else if (Actor->bOnlyRelevantToOwner)
+	{
+		// Not in any global node, see RouteAddNetworkActorToNodes
+	}
+	else if (Actor->IsA<AMovementPredictionCharacter>() || Actor->IsA<AMovementPredictionProjectile>())
+	{
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+	}
+	else
+	{
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+	}
+
+	if (Actor->IsA<APawn>() || Actor->IsA<APlayerController>())
+	{
+		// Closed connections take their nodes with them
+		OwnerRelevantNodes.RemoveAllSwap([Actor](const TWeakObjectPtr<UMovementPredictionReplicationGraphNode_OwnerRelevant>& Node)
+		{
+			if (Node.IsValid())
+			{
+				Node->OnActorRemoved(Actor);
+				return false;
+			}
+			return true;
+		});
+	}
+}
+
+void UMovementPredictionReplicationGraphNode_OwnerRelevant::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	APlayerController* Controller = Params.ConnectionManager.NetConnection ? Params.ConnectionManager.NetConnection->PlayerController : nullptr;
+	APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+	if (Pawn && Pawn->IsPendingKill())
+	{
+		Pawn = nullptr;
+	}
+
+	AActor* ViewTarget = Params.Viewer.ViewTarget;
+	if (ViewTarget == Pawn || ViewTarget == Controller || (ViewTarget && !ViewTarget->GetIsReplicated()))
+	{
+		ViewTarget = nullptr;
+	}
+
+	// Nearly every frame none of these changed
+	UpdateTrackedActor(LastController, Controller);
+	UpdateTrackedActor(LastPawn, Pawn);
+	UpdateTrackedActor(LastViewTarget, ViewTarget);
+
+	Super::GatherActorListsForConnection(Params);
+}
+
+void UMovementPredictionReplicationGraphNode_OwnerRelevant::OnActorRemoved(AActor* Actor)
+{
+	if (LastController == Actor)
+	{
+		UpdateTrackedActor(LastController, nullptr);
+	}
+	if (LastPawn == Actor)
+	{
+		UpdateTrackedActor(LastPawn, nullptr);
+	}
+	if (LastViewTarget == Actor)
+	{
+		UpdateTrackedActor(LastViewTarget, nullptr);
+	}
+}
+
+void UMovementPredictionReplicationGraphNode_OwnerRelevant::UpdateTrackedActor(AActor*& Slot, AActor* NewActor)
+{
+	if (Slot == NewActor)
+	{
+		return;
+	}
+
+	if (Slot)
+	{
+		NotifyRemoveNetworkActor(FNewReplicatedActorInfo(Slot));
+	}
+
+	Slot = NewActor;
+
+	if (NewActor)
+	{
+		NotifyAddNetworkActor(FNewReplicatedActorInfo(NewActor));
+	}
+}
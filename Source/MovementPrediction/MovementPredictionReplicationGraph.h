@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "MovementPredictionReplicationGraph.generated.h"
+
+class UMovementPredictionReplicationGraphNode_OwnerRelevant;
+
+/**
+ * Replaces the per-actor relevancy checks the net driver does for every actor against every connection each net tick.
+ *
+ *  - Characters and projectiles go into a spatial grid, each grid cell buckets its moving actors by view distance and
+ *    direction so far and behind-you actors replicate less often
+ *  - Each connection gets its controller and its own pawn (first person mesh, predicted movement state) no matter where the grid puts them
+ *  - bAlwaysRelevant actors (game state, player states) go to every connection
+ *
+ * Used for the game net driver unless mp.ReplicationGraph is 0 or the server is started with -MPRepGraph=0.
+ */
+UCLASS(transient, config=Engine)
+class UMovementPredictionReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UMovementPredictionReplicationGraph();
+
+	// Begin UReplicationGraph Interface
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* ConnectionManager) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	// End UReplicationGraph Interface
+
+	/** Binds the replication driver factory, call once at module startup */
+	static void RegisterReplicationDriver();
+
+	/** Grid cell size, bigger cells mean fewer cells to gather per connection but more actors per cell */
+	UPROPERTY(config)
+	float GridCellSize;
+
+	/** Grid origin offset, lets cell coordinates stay positive on maps centered on the world origin */
+	UPROPERTY(config)
+	FVector2D GridSpatialBias;
+
+private:
+
+	/** Replication frames between updates for an actor class that wants NetUpdateFrequency updates per second */
+	uint16 GetReplicationPeriodFrame(float NetUpdateFrequency) const;
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	/** Per connection nodes, told when a pawn goes away so they don't hold on to it until their next gather */
+	TArray<TWeakObjectPtr<UMovementPredictionReplicationGraphNode_OwnerRelevant>> OwnerRelevantNodes;
+};
+
+/** Keeps a connection's player controller, its pawn and its view target relevant to that connection only */
+UCLASS()
+class UMovementPredictionReplicationGraphNode_OwnerRelevant : public UReplicationGraphNode_AlwaysRelevant_ForConnection
+{
+	GENERATED_BODY()
+
+public:
+	// Begin UReplicationGraphNode Interface
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+	// End UReplicationGraphNode Interface
+
+	/** Drops Actor if this node was tracking it */
+	void OnActorRemoved(AActor* Actor);
+
+private:
+
+	/** Swaps the tracked actor in Slot for NewActor */
+	void UpdateTrackedActor(AActor*& Slot, AActor* NewActor);
+
+	AActor* LastController = nullptr;
+	AActor* LastPawn = nullptr;
+	AActor* LastViewTarget = nullptr;
+};
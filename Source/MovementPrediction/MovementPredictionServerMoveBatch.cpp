@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementPredictionServerMoveBatch.h"
+#include "MovementPrediction.h"
+#include "ReallyCoolMovementComponent.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Server Move Batch"), STAT_MovementPrediction_ServerMoveBatch, STATGROUP_MovementPrediction);
+DECLARE_CYCLE_STAT(TEXT("Server Move Batch Floors"), STAT_MovementPrediction_ServerMoveBatchFloors, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Characters"), STAT_MovementPrediction_BatchedCharacters, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Independent Characters"), STAT_MovementPrediction_IndependentCharacters, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Floors Precomputed"), STAT_MovementPrediction_FloorsPrecomputed, STATGROUP_MovementPrediction);
+
+static TAutoConsoleVariable<int32> CVarBatchServerMoves(
+	TEXT("mp.BatchServerMoves"),
+	0,
+	TEXT("How the server processes ServerMoves from remote clients, when the server move buffer isn't holding them.\n")
+	TEXT("0: as soon as they arrive (default)\n")
+	TEXT("1: once per frame in one batch, floors for characters away from everyone else looked up on worker threads first\n")
+	TEXT("2: same as 1, but the floors are looked up on the game thread"),
+	ECVF_Default);
+
+UMovementPredictionServerMoveBatch::UMovementPredictionServerMoveBatch()
+{
+	InteractionMargin = 50.f;
+}
+
+void UMovementPredictionServerMoveBatch::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// After TickDispatch has received every RPC for the frame, before anything ticks - where the moves would have run anyway
+	PostTickDispatchHandle = GetWorld()->OnPostTickDispatch().AddUObject(this, &UMovementPredictionServerMoveBatch::ProcessBatch);
+}
+
+void UMovementPredictionServerMoveBatch::Deinitialize()
+{
+	GetWorld()->OnPostTickDispatch().Remove(PostTickDispatchHandle);
+	PendingMovements.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UMovementPredictionServerMoveBatch::IsEnabled()
+{
+	return CVarBatchServerMoves.GetValueOnGameThread() != 0;
+}
+
+void UMovementPredictionServerMoveBatch::AddMovement(UReallyCoolMovementComponent* Movement)
+{
+	PendingMovements.AddUnique(Movement);
+}
+
+void UMovementPredictionServerMoveBatch::ProcessBatch()
+{
+	if (PendingMovements.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_ServerMoveBatch);
+
+	Batch.Reset();
+	for (const TWeakObjectPtr<UReallyCoolMovementComponent>& Movement : PendingMovements)
+	{
+		if (Movement.IsValid())
+		{
+			FBatchEntry& Entry = Batch.AddDefaulted_GetRef();
+			Entry.Movement = Movement;
+			Entry.bIndependent = Movement->GetServerMoveBatchBounds(Entry.Bounds);
+			if (Entry.Bounds.IsValid)
+			{
+				Entry.Bounds = Entry.Bounds.ExpandBy(InteractionMargin);
+			}
+		}
+	}
+	PendingMovements.Reset();
+
+	// Sort and sweep along X, anyone whose bounds overlap someone else's could end up standing on them or in their way
+	SortedEntries.Reset();
+	for (int32 Index = 0; Index < Batch.Num(); ++Index)
+	{
+		SortedEntries.Add(Index);
+	}
+	SortedEntries.Sort([this](int32 A, int32 B) { return Batch[A].Bounds.Min.X < Batch[B].Bounds.Min.X; });
+
+	for (int32 SortedIndex = 0; SortedIndex < SortedEntries.Num(); ++SortedIndex)
+	{
+		FBatchEntry& Entry = Batch[SortedEntries[SortedIndex]];
+		for (int32 OtherIndex = SortedIndex + 1; OtherIndex < SortedEntries.Num(); ++OtherIndex)
+		{
+			FBatchEntry& Other = Batch[SortedEntries[OtherIndex]];
+			if (Other.Bounds.Min.X > Entry.Bounds.Max.X)
+			{
+				break;
+			}
+			if (Entry.Bounds.IsValid && Other.Bounds.IsValid && Entry.Bounds.Intersect(Other.Bounds))
+			{
+				Entry.bIndependent = false;
+				Other.bIndependent = false;
+			}
+		}
+	}
+
+	IndependentEntries.Reset();
+	for (int32 Index = 0; Index < Batch.Num(); ++Index)
+	{
+		if (Batch[Index].bIndependent)
+		{
+			IndependentEntries.Add(Index);
+		}
+	}
+
+	int32 NumFloorsPrecomputed = 0;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_ServerMoveBatchFloors);
+
+		// Only scene queries on the workers, and every movement only touches its own floors
+		const bool bSingleThreaded = CVarBatchServerMoves.GetValueOnGameThread() == 2;
+		ParallelFor(IndependentEntries.Num(), [this](int32 Index)
+		{
+			Batch[IndependentEntries[Index]].Movement->PrecomputeServerMoveFloors();
+		}, bSingleThreaded);
+
+		for (const int32 Index : IndependentEntries)
+		{
+			NumFloorsPrecomputed += Batch[Index].Movement->GetNumPrecomputedFloors();
+		}
+	}
+
+	for (int32 Index = 0; Index < Batch.Num(); ++Index)
+	{
+		UReallyCoolMovementComponent* Movement = Batch[Index].Movement.Get();
+		if (!Movement)
+		{
+			continue;
+		}
+
+		// Ending up somewhere the client never said it went can put us under someone later in the batch, whose floor is now wrong
+		const FBox Moved = Movement->ProcessBatchedServerMoves();
+		if (Moved.IsValid && !Batch[Index].Bounds.IsInside(Moved))
+		{
+			for (int32 LaterIndex = Index + 1; LaterIndex < Batch.Num(); ++LaterIndex)
+			{
+				if (Batch[LaterIndex].bIndependent && Batch[LaterIndex].Bounds.Intersect(Moved) && Batch[LaterIndex].Movement.IsValid())
+				{
+					Batch[LaterIndex].Movement->DiscardPrecomputedFloors();
+				}
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_MovementPrediction_BatchedCharacters, Batch.Num());
+	INC_DWORD_STAT_BY(STAT_MovementPrediction_IndependentCharacters, IndependentEntries.Num());
+	INC_DWORD_STAT_BY(STAT_MovementPrediction_FloorsPrecomputed, NumFloorsPrecomputed);
+	CSV_CUSTOM_STAT(MovementPrediction, BatchedCharacters, Batch.Num(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(MovementPrediction, IndependentCharacters, IndependentEntries.Num(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(MovementPrediction, FloorsPrecomputed, NumFloorsPrecomputed, ECsvCustomStatOp::Set);
+}
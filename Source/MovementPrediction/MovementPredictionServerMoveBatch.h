@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MovementPredictionServerMoveBatch.generated.h"
+
+class UReallyCoolMovementComponent;
+
+/**
+ * Server only - holds every connection's ServerMoves back until the net driver has received the whole frame, then
+ * processes them in one batch instead of one RPC at a time.
+ *
+ * Moving a character isn't thread safe (component transforms, overlaps, physics bodies), so the moves themselves still run
+ * on the game thread. What does go wide is each move's floor check: for characters whose moves don't come near anyone
+ * else's, the floor under where the client said each walking move ended is looked up on task graph workers first.
+ * Nothing can move while they run, so they query the physics scene as it was when the frame's moves arrived, and the
+ * game thread reuses those floors when the server ends the move where the client did.
+ *
+ * Off by default, see mp.BatchServerMoves. Moves going through the server move buffer aren't batched.
+ */
+UCLASS(config=Game)
+class UMovementPredictionServerMoveBatch : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UMovementPredictionServerMoveBatch();
+
+	// Begin USubsystem Interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End USubsystem Interface
+
+	/** If ServerMoves should be batched, rather than processed as they arrive */
+	static bool IsEnabled();
+
+	/** Processes Movement's batched moves with this frame's batch */
+	void AddMovement(UReallyCoolMovementComponent* Movement);
+
+protected:
+
+	/** Characters whose moves come within this of each other are treated as interacting, and don't get their floors looked up ahead */
+	UPROPERTY(config)
+	float InteractionMargin;
+
+private:
+
+	/** Runs once all of this frame's packets have been received */
+	void ProcessBatch();
+
+	struct FBatchEntry
+	{
+		TWeakObjectPtr<UReallyCoolMovementComponent> Movement;
+
+		// Everywhere the moves can take the capsule and its floor check, plus InteractionMargin
+		FBox Bounds;
+
+		uint8 bIndependent : 1;
+	};
+
+	/** Movements with moves waiting, in the order their first move arrived */
+	TArray<TWeakObjectPtr<UReallyCoolMovementComponent>> PendingMovements;
+
+	// Scratch for ProcessBatch, kept to save reallocating every frame
+	TArray<FBatchEntry> Batch;
+	TArray<int32> SortedEntries;
+	TArray<int32> IndependentEntries;
+
+	FDelegateHandle PostTickDispatchHandle;
+};
@@ -0,0 +1,187 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementPredictionSignificanceManager.h"
+#include "MovementPrediction.h"
+#include "MovementPredictionCharacter.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_MovementPrediction_SignificanceUpdate, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Characters Throttled"), STAT_MovementPrediction_CharactersThrottled, STATGROUP_MovementPrediction);
+
+static TAutoConsoleVariable<int32> CVarSignificance(
+	TEXT("mp.Significance"),
+	1,
+	TEXT("How often other players' characters tick.\n")
+	TEXT("0: every frame\n")
+	TEXT("1: less often the further away and further out of view they are (default)"),
+	ECVF_Default);
+
+namespace MovementPredictionSignificance
+{
+	// Significance of each bucket, higher ticks more often
+	const float Hidden = 0.f;
+	const float Far = 1.f;
+	const float Mid = 2.f;
+	const float Near = 3.f;
+}
+
+UMovementPredictionSignificanceManager::UMovementPredictionSignificanceManager()
+{
+	NearDistance = 2500.f;
+	MidDistance = 6000.f;
+	MidTickInterval = 1.f / 30.f;
+	FarTickInterval = 1.f / 15.f;
+	HiddenTickInterval = 0.2f;
+	ViewConeMarginDegrees = 10.f;
+
+	ViewConeCos = 0.f;
+	bWasEnabled = false;
+}
+
+TStatId UMovementPredictionSignificanceManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMovementPredictionSignificanceManager, STATGROUP_Tickables);
+}
+
+UWorld* UMovementPredictionSignificanceManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UMovementPredictionSignificanceManager::IsTickable() const
+{
+	return !IsTemplate() && Characters.Num() > 0;
+}
+
+void UMovementPredictionSignificanceManager::RegisterCharacter(AMovementPredictionCharacter* Character)
+{
+	if (!Character || Characters.Contains(Character))
+	{
+		return;
+	}
+
+	Characters.Add(Character);
+
+	RegisterObject(Character, AMovementPredictionCharacter::StaticClass()->GetFName(),
+		[this](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint)
+		{
+			return CalculateSignificance(CastChecked<AMovementPredictionCharacter>(ObjectInfo->GetObject()), Viewpoint);
+		},
+		USignificanceManager::EPostSignificanceType::Sequential,
+		[this](USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, float Significance, bool bFinal)
+		{
+			// Unregistering puts the character back to every frame
+			const float TickInterval = bFinal ? 0.f : GetTickInterval(Significance);
+			CastChecked<AMovementPredictionCharacter>(ObjectInfo->GetObject())->SetSignificanceTickInterval(TickInterval);
+		});
+}
+
+void UMovementPredictionSignificanceManager::UnregisterCharacter(AMovementPredictionCharacter* Character)
+{
+	if (Characters.Remove(Character) > 0)
+	{
+		UnregisterObject(Character);
+	}
+}
+
+void UMovementPredictionSignificanceManager::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_SignificanceUpdate);
+
+	const bool bEnabled = CVarSignificance.GetValueOnGameThread() != 0;
+	if (!bEnabled)
+	{
+		if (bWasEnabled)
+		{
+			for (const TWeakObjectPtr<AMovementPredictionCharacter>& Character : Characters)
+			{
+				if (Character.IsValid())
+				{
+					Character->SetSignificanceTickInterval(0.f);
+				}
+			}
+			bWasEnabled = false;
+		}
+		return;
+	}
+	bWasEnabled = true;
+
+	// Every local player's camera, split screen takes whichever of them a character matters most to
+	Viewpoints.Reset();
+	float MaxFOV = 0.f;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+		if (PC && PC->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			Viewpoints.Add(FTransform(ViewRotation, ViewLocation));
+
+			MaxFOV = FMath::Max(MaxFOV, PC->PlayerCameraManager ? PC->PlayerCameraManager->GetFOVAngle() : 90.f);
+		}
+	}
+
+	if (Viewpoints.Num() == 0)
+	{
+		return;
+	}
+
+	ViewConeCos = FMath::Cos(FMath::DegreesToRadians(FMath::Min(MaxFOV * 0.5f + ViewConeMarginDegrees, 180.f)));
+	Update(Viewpoints);
+
+	int32 NumThrottled = 0;
+	for (const TWeakObjectPtr<AMovementPredictionCharacter>& Character : Characters)
+	{
+		if (Character.IsValid() && GetSignificance(Character.Get()) < MovementPredictionSignificance::Near)
+		{
+			++NumThrottled;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_MovementPrediction_CharactersThrottled, NumThrottled);
+	CSV_CUSTOM_STAT(MovementPrediction, CharactersThrottled, NumThrottled, ECsvCustomStatOp::Set);
+}
+
+float UMovementPredictionSignificanceManager::CalculateSignificance(const AMovementPredictionCharacter* Character, const FTransform& Viewpoint) const
+{
+	const FVector ToCharacter = Character->GetActorLocation() - Viewpoint.GetLocation();
+	const float DistanceSquared = ToCharacter.SizeSquared();
+
+	// First person characters have nothing for anyone else to render, so in view means in front of the camera
+	const bool bInView = Character->WasRecentlyRendered(0.25f) || (ToCharacter.GetSafeNormal() | Viewpoint.GetRotation().GetForwardVector()) >= ViewConeCos;
+
+	if (DistanceSquared <= FMath::Square(NearDistance))
+	{
+		return bInView ? MovementPredictionSignificance::Near : MovementPredictionSignificance::Mid;
+	}
+
+	if (!bInView)
+	{
+		return MovementPredictionSignificance::Hidden;
+	}
+
+	return DistanceSquared <= FMath::Square(MidDistance) ? MovementPredictionSignificance::Mid : MovementPredictionSignificance::Far;
+}
+
+float UMovementPredictionSignificanceManager::GetTickInterval(float Significance) const
+{
+	if (Significance >= MovementPredictionSignificance::Near)
+	{
+		return 0.f;
+	}
+	if (Significance >= MovementPredictionSignificance::Mid)
+	{
+		return MidTickInterval;
+	}
+	if (Significance >= MovementPredictionSignificance::Far)
+	{
+		return FarTickInterval;
+	}
+	return HiddenTickInterval;
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SignificanceManager.h"
+#include "Tickable.h"
+#include "MovementPredictionSignificanceManager.generated.h"
+
+class AMovementPredictionCharacter;
+
+/**
+ * Ticks other players' characters less often the less they matter to the local player.
+ *
+ *  - In view and within NearDistance: every frame
+ *  - In view within MidDistance, or out of view within NearDistance: every MidTickInterval
+ *  - In view further out: every FarTickInterval
+ *  - Out of view further out: every HiddenTickInterval
+ *
+ * Throttled characters still move their mesh every frame, the movement component smooths it toward the capsule between
+ * simulation steps the same way it smooths net updates. Only simulated proxies are registered, so this does nothing on servers.
+ *
+ * Set as the engine's SignificanceManagerClassName in DefaultEngine.ini, off with mp.Significance 0 or -MPSignificance=0.
+ */
+UCLASS(config=Game)
+class UMovementPredictionSignificanceManager : public USignificanceManager, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UMovementPredictionSignificanceManager();
+
+	// Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End FTickableGameObject Interface
+
+	void RegisterCharacter(AMovementPredictionCharacter* Character);
+
+	void UnregisterCharacter(AMovementPredictionCharacter* Character);
+
+protected:
+
+	UPROPERTY(config)
+	float NearDistance;
+
+	UPROPERTY(config)
+	float MidDistance;
+
+	UPROPERTY(config)
+	float MidTickInterval;
+
+	UPROPERTY(config)
+	float FarTickInterval;
+
+	UPROPERTY(config)
+	float HiddenTickInterval;
+
+	/** Added to half the camera's FOV for the in-view test, so characters at the edge of the screen don't flicker between rates */
+	UPROPERTY(config)
+	float ViewConeMarginDegrees;
+
+private:
+
+	float CalculateSignificance(const AMovementPredictionCharacter* Character, const FTransform& Viewpoint) const;
+
+	/** Tick interval for a significance from CalculateSignificance */
+	float GetTickInterval(float Significance) const;
+
+	TArray<TWeakObjectPtr<AMovementPredictionCharacter>> Characters;
+
+	TArray<FTransform> Viewpoints;
+
+	/** Cosine of the in-view cone's half angle, from the local player's camera */
+	float ViewConeCos;
+
+	bool bWasEnabled;
+};
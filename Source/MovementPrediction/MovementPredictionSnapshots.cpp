@@ -0,0 +1,614 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementPredictionSnapshots.h"
+#include "MovementPrediction.h"
+#include "MovementPredictionCharacter.h"
+#include "ReallyCoolMovementComponent.h"
+#include "Algo/BinarySearch.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMovementSnapshots, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Snapshot Send"), STAT_MovementPrediction_SnapshotSend, STATGROUP_MovementPrediction);
+DECLARE_CYCLE_STAT(TEXT("Snapshot Interpolation"), STAT_MovementPrediction_SnapshotInterpolation, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshots Sent"), STAT_MovementPrediction_SnapshotsSent, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshot Bytes Sent"), STAT_MovementPrediction_SnapshotBytesSent, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshots Received"), STAT_MovementPrediction_SnapshotsReceived, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshot Buffer Underruns"), STAT_MovementPrediction_SnapshotBufferUnderruns, STATGROUP_MovementPrediction);
+
+static TAutoConsoleVariable<int32> CVarSnapshots(
+	TEXT("mp.Snapshots"),
+	0,
+	TEXT("How the server sends remote characters' movement to clients, can be changed while running.\n")
+	TEXT("0: each character replicates its own movement, clients simulate and smooth it (default)\n")
+	TEXT("1: delta compressed world snapshots, clients interpolate remote characters a fixed delay behind them"),
+	ECVF_Default);
+
+// Snapshots kept on both sides. Baselines older than this get a full snapshot instead.
+static const int32 SnapshotHistorySize = 32;
+
+// More characters than this in one snapshot can only be a bad packet
+static const uint32 MaxSnapshotCharacters = 1024;
+
+// Snapshot locations are in tenths of a unit
+static const float SnapshotLocationScale = 10.f;
+
+static uint32 ZigZag(int32 Value)
+{
+	return (uint32(Value) << 1) ^ uint32(Value >> 31);
+}
+
+static int32 UnZigZag(uint32 Value)
+{
+	return int32(Value >> 1) ^ -int32(Value & 1);
+}
+
+// Small differences pack into a byte or two
+static void WriteIntVector(FBitWriter& Writer, const FIntVector& Value, const FIntVector& Base)
+{
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		uint32 Packed = ZigZag(Value[Axis] - Base[Axis]);
+		Writer.SerializeIntPacked(Packed);
+	}
+}
+
+static FIntVector ReadIntVector(FBitReader& Reader, const FIntVector& Base)
+{
+	FIntVector Value;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		uint32 Packed = 0;
+		Reader.SerializeIntPacked(Packed);
+		Value[Axis] = Base[Axis] + UnZigZag(Packed);
+	}
+	return Value;
+}
+
+const FMovementSnapshotEntry* FMovementSnapshot::FindEntry(uint16 CharacterId) const
+{
+	const int32 Index = Algo::BinarySearchBy(Entries, CharacterId, &FMovementSnapshotEntry::CharacterId);
+	return Index != INDEX_NONE ? &Entries[Index] : nullptr;
+}
+
+UMovementPredictionSnapshots::UMovementPredictionSnapshots()
+{
+	SnapshotRate = 20.f;
+	InterpolationDelay = 0.1f;
+	NewestId = 0;
+	SnapshotTimeOwed = 0.f;
+	NextCharacterId = 1;
+	bSendingSnapshots = false;
+	ServerTimeOffset = 0.f;
+	bHasServerTimeOffset = false;
+}
+
+void UMovementPredictionSnapshots::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	History.SetNum(SnapshotHistorySize);
+}
+
+void UMovementPredictionSnapshots::Deinitialize()
+{
+	Characters.Reset();
+	FreedCharacterIds.Reset();
+	History.Reset();
+
+	Super::Deinitialize();
+}
+
+TStatId UMovementPredictionSnapshots::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMovementPredictionSnapshots, STATGROUP_Tickables);
+}
+
+UWorld* UMovementPredictionSnapshots::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UMovementPredictionSnapshots::IsTickable() const
+{
+	return !IsTemplate() && Characters.Num() > 0;
+}
+
+bool UMovementPredictionSnapshots::IsEnabled()
+{
+	return CVarSnapshots.GetValueOnGameThread() != 0;
+}
+
+void UMovementPredictionSnapshots::Tick(float DeltaTime)
+{
+	const ENetMode NetMode = GetWorld()->GetNetMode();
+	if (NetMode == NM_Client)
+	{
+		InterpolateCharacters();
+		return;
+	}
+
+	if (NetMode == NM_Standalone)
+	{
+		return;
+	}
+
+	// Flip every character over when the cvar changes, clients follow bReplicateMovement
+	const bool bEnabled = IsEnabled();
+	if (bEnabled != bSendingSnapshots)
+	{
+		bSendingSnapshots = bEnabled;
+		SnapshotTimeOwed = 0.f;
+
+		for (FSnapshotCharacter& Entry : Characters)
+		{
+			if (AMovementPredictionCharacter* Character = Entry.Character.Get())
+			{
+				Character->SetReplicatingMovement(!bEnabled);
+			}
+			Entry.LastAckedId = 0;
+		}
+	}
+
+	if (!bSendingSnapshots)
+	{
+		return;
+	}
+
+	const float SnapshotInterval = 1.f / FMath::Max(SnapshotRate, 1.f);
+	SnapshotTimeOwed += DeltaTime;
+	if (SnapshotTimeOwed < SnapshotInterval)
+	{
+		return;
+	}
+
+	// No catching up after a hitch, the one snapshot has everyone's newest state anyway
+	SnapshotTimeOwed = FMath::Min(SnapshotTimeOwed - SnapshotInterval, SnapshotInterval);
+
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_SnapshotSend);
+
+	TakeSnapshot();
+	SendSnapshots();
+}
+
+void UMovementPredictionSnapshots::RegisterCharacter(AMovementPredictionCharacter* Character)
+{
+	if (!Character || Characters.ContainsByPredicate([Character](const FSnapshotCharacter& Entry) { return Entry.Character == Character; }))
+	{
+		return;
+	}
+
+	FSnapshotCharacter& Entry = Characters.AddDefaulted_GetRef();
+	Entry.Character = Character;
+	Entry.LastAckedId = 0;
+
+	if (Character->HasAuthority())
+	{
+		// Freed IDs come back once every snapshot either side could still hold their old character is gone, so respawns
+		// on a long running server never run out of them or hand out one that's still in use
+		if (FreedCharacterIds.Num() > 0 && NewestId - FreedCharacterIds[0].FreedAtSnapshotId >= (uint32)SnapshotHistorySize)
+		{
+			Entry.CharacterId = FreedCharacterIds[0].CharacterId;
+			FreedCharacterIds.RemoveAt(0, 1, false);
+		}
+		else if (NextCharacterId != 0)
+		{
+			Entry.CharacterId = NextCharacterId++;
+		}
+		else
+		{
+			// 0 is never given out, it's what clients see for characters the server hasn't numbered. Left out of snapshots.
+			Entry.CharacterId = 0;
+			UE_LOG(LogMovementSnapshots, Warning, TEXT("Out of snapshot IDs, %s won't be in snapshots"), *Character->GetName());
+		}
+		Character->SetSnapshotId(Entry.CharacterId);
+		Character->SetReplicatingMovement(!bSendingSnapshots);
+	}
+	else
+	{
+		// Replicated with the character's initial properties, before BeginPlay
+		Entry.CharacterId = Character->GetSnapshotId();
+	}
+}
+
+void UMovementPredictionSnapshots::UnregisterCharacter(AMovementPredictionCharacter* Character)
+{
+	for (int32 Index = Characters.Num() - 1; Index >= 0; --Index)
+	{
+		const FSnapshotCharacter& Entry = Characters[Index];
+		if (Entry.Character != Character && Entry.Character.IsValid())
+		{
+			continue;
+		}
+
+		if (Entry.CharacterId != 0 && GetWorld()->GetNetMode() != NM_Client)
+		{
+			FFreedCharacterId& Freed = FreedCharacterIds.AddDefaulted_GetRef();
+			Freed.CharacterId = Entry.CharacterId;
+			Freed.FreedAtSnapshotId = NewestId;
+		}
+		Characters.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+const FMovementSnapshot* UMovementPredictionSnapshots::FindSnapshot(uint32 Id) const
+{
+	if (Id == 0 || Id > NewestId || NewestId - Id >= (uint32)SnapshotHistorySize)
+	{
+		return nullptr;
+	}
+
+	const FMovementSnapshot& Snapshot = History[Id % SnapshotHistorySize];
+	return Snapshot.Id == Id ? &Snapshot : nullptr;
+}
+
+void UMovementPredictionSnapshots::TakeSnapshot()
+{
+	FMovementSnapshot& Snapshot = History[++NewestId % SnapshotHistorySize];
+	Snapshot.Id = NewestId;
+	Snapshot.ServerTime = GetWorld()->GetTimeSeconds();
+	Snapshot.Entries.Reset();
+
+	for (const FSnapshotCharacter& Entry : Characters)
+	{
+		const AMovementPredictionCharacter* Character = Entry.Character.Get();
+		const UReallyCoolMovementComponent* Movement = Character ? Cast<UReallyCoolMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+		if (!Movement || Entry.CharacterId == 0)
+		{
+			continue;
+		}
+
+		const FVector Location = Character->GetActorLocation() * SnapshotLocationScale;
+		const FVector& Velocity = Movement->Velocity;
+
+		FMovementSnapshotEntry& SnapshotEntry = Snapshot.Entries.AddDefaulted_GetRef();
+		SnapshotEntry.CharacterId = Entry.CharacterId;
+		SnapshotEntry.Location = FIntVector(FMath::RoundToInt(Location.X), FMath::RoundToInt(Location.Y), FMath::RoundToInt(Location.Z));
+		SnapshotEntry.Velocity = FIntVector(FMath::RoundToInt(Velocity.X), FMath::RoundToInt(Velocity.Y), FMath::RoundToInt(Velocity.Z));
+		SnapshotEntry.Yaw = FRotator::CompressAxisToShort(Character->GetActorRotation().Yaw);
+		SnapshotEntry.bDashing = Movement->IsDashing();
+	}
+
+	Snapshot.Entries.Sort([](const FMovementSnapshotEntry& A, const FMovementSnapshotEntry& B) { return A.CharacterId < B.CharacterId; });
+}
+
+void UMovementPredictionSnapshots::SendSnapshots()
+{
+	const FMovementSnapshot& Snapshot = History[NewestId % SnapshotHistorySize];
+
+	int32 NumSent = 0;
+	int32 BytesSent = 0;
+	for (FSnapshotCharacter& Viewer : Characters)
+	{
+		// Remote clients only, through the character they control
+		AMovementPredictionCharacter* Character = Viewer.Character.Get();
+		UNetConnection* Connection = Character && !Character->IsLocallyControlled() ? Character->GetNetConnection() : nullptr;
+		if (!Connection)
+		{
+			continue;
+		}
+
+		if (Viewer.SentSnapshots.Num() == 0)
+		{
+			Viewer.SentSnapshots.SetNum(SnapshotHistorySize);
+		}
+
+		// The client only has the characters it was sent in the baseline, anyone else has to go in full
+		const FMovementSnapshot* Baseline = FindSnapshot(Viewer.LastAckedId);
+		const FSentSnapshot* BaselineSent = Baseline ? &Viewer.SentSnapshots[Baseline->Id % SnapshotHistorySize] : nullptr;
+		if (BaselineSent && BaselineSent->SnapshotId != Baseline->Id)
+		{
+			Baseline = nullptr;
+			BaselineSent = nullptr;
+		}
+
+		// Only the characters the client has a channel open for, which leaves out everything relevancy and the replication
+		// graph's cull distances would. The client has no actor to place for the rest.
+		FSentSnapshot& Sent = Viewer.SentSnapshots[Snapshot.Id % SnapshotHistorySize];
+		Sent.SnapshotId = Snapshot.Id;
+		Sent.CharacterIds.Reset();
+		for (const FSnapshotCharacter& Other : Characters)
+		{
+			if (&Other != &Viewer && Snapshot.FindEntry(Other.CharacterId) && Connection->FindActorChannelRef(Other.Character))
+			{
+				Sent.CharacterIds.Add(Other.CharacterId);
+			}
+		}
+		Sent.CharacterIds.Sort();
+
+		FBitWriter Writer(0, true);
+		WriteSnapshot(Writer, Snapshot, Sent.CharacterIds, Baseline, BaselineSent ? &BaselineSent->CharacterIds : nullptr);
+
+		Packet.SnapshotId = Snapshot.Id;
+		Packet.BaselineId = Baseline ? Baseline->Id : 0;
+		Packet.ServerTime = Snapshot.ServerTime;
+		Packet.Data.Reset();
+		Packet.Data.Append(Writer.GetData(), Writer.GetNumBytes());
+		Character->ClientRPC_ReceiveSnapshot(Packet);
+
+		++NumSent;
+		BytesSent += Packet.Data.Num();
+	}
+
+	INC_DWORD_STAT_BY(STAT_MovementPrediction_SnapshotsSent, NumSent);
+	INC_DWORD_STAT_BY(STAT_MovementPrediction_SnapshotBytesSent, BytesSent);
+	CSV_CUSTOM_STAT(MovementPrediction, SnapshotBytesSent, BytesSent, ECsvCustomStatOp::Accumulate);
+}
+
+void UMovementPredictionSnapshots::WriteSnapshot(FBitWriter& Writer, const FMovementSnapshot& Snapshot, const TArray<uint16>& CharacterIds, const FMovementSnapshot* Baseline, const TArray<uint16>* BaselineIds)
+{
+	uint32 NumEntries = CharacterIds.Num();
+	Writer.SerializeIntPacked(NumEntries);
+
+	uint16 PreviousId = 0;
+	for (uint16 CharacterId : CharacterIds)
+	{
+		const FMovementSnapshotEntry* EntryPtr = Snapshot.FindEntry(CharacterId);
+		check(EntryPtr);
+		const FMovementSnapshotEntry& Entry = *EntryPtr;
+
+		// Sorted, so IDs go up in small steps
+		uint32 IdDelta = Entry.CharacterId - PreviousId;
+		Writer.SerializeIntPacked(IdDelta);
+		PreviousId = Entry.CharacterId;
+
+		uint16 Yaw = Entry.Yaw;
+
+		// Just what changed since the baseline, as a difference from it
+		const bool bInBaseline = BaselineIds && Algo::BinarySearch(*BaselineIds, Entry.CharacterId) != INDEX_NONE;
+		const FMovementSnapshotEntry* Base = bInBaseline ? Baseline->FindEntry(Entry.CharacterId) : nullptr;
+		Writer.WriteBit(Base != nullptr);
+		if (Base)
+		{
+			const bool bMoved = Entry.Location != Base->Location;
+			Writer.WriteBit(bMoved);
+			if (bMoved)
+			{
+				WriteIntVector(Writer, Entry.Location, Base->Location);
+			}
+
+			const bool bVelocityChanged = Entry.Velocity != Base->Velocity;
+			Writer.WriteBit(bVelocityChanged);
+			if (bVelocityChanged)
+			{
+				WriteIntVector(Writer, Entry.Velocity, Base->Velocity);
+			}
+
+			const bool bTurned = Entry.Yaw != Base->Yaw;
+			Writer.WriteBit(bTurned);
+			if (bTurned)
+			{
+				Writer << Yaw;
+			}
+
+			// The dash flag is sent whole every time, a changed bit would cost as much
+			Writer.WriteBit(Entry.bDashing);
+		}
+		else
+		{
+			WriteIntVector(Writer, Entry.Location, FIntVector::ZeroValue);
+			WriteIntVector(Writer, Entry.Velocity, FIntVector::ZeroValue);
+			Writer << Yaw;
+			Writer.WriteBit(Entry.bDashing);
+		}
+	}
+}
+
+bool UMovementPredictionSnapshots::ReadSnapshot(FBitReader& Reader, const FMovementSnapshot* Baseline, FMovementSnapshot& OutSnapshot)
+{
+	uint32 NumEntries = 0;
+	Reader.SerializeIntPacked(NumEntries);
+	if (Reader.IsError() || NumEntries > MaxSnapshotCharacters)
+	{
+		return false;
+	}
+
+	OutSnapshot.Entries.Reset();
+
+	uint16 PreviousId = 0;
+	for (uint32 Index = 0; Index < NumEntries; ++Index)
+	{
+		uint32 IdDelta = 0;
+		Reader.SerializeIntPacked(IdDelta);
+
+		FMovementSnapshotEntry& Entry = OutSnapshot.Entries.AddDefaulted_GetRef();
+		Entry.CharacterId = PreviousId + IdDelta;
+		PreviousId = Entry.CharacterId;
+
+		if (Reader.ReadBit())
+		{
+			const FMovementSnapshotEntry* Base = Baseline ? Baseline->FindEntry(Entry.CharacterId) : nullptr;
+			if (!Base)
+			{
+				return false;
+			}
+
+			Entry.Location = Reader.ReadBit() ? ReadIntVector(Reader, Base->Location) : Base->Location;
+			Entry.Velocity = Reader.ReadBit() ? ReadIntVector(Reader, Base->Velocity) : Base->Velocity;
+
+			Entry.Yaw = Base->Yaw;
+			if (Reader.ReadBit())
+			{
+				Reader << Entry.Yaw;
+			}
+
+			Entry.bDashing = Reader.ReadBit();
+		}
+		else
+		{
+			Entry.Location = ReadIntVector(Reader, FIntVector::ZeroValue);
+			Entry.Velocity = ReadIntVector(Reader, FIntVector::ZeroValue);
+			Reader << Entry.Yaw;
+			Entry.bDashing = Reader.ReadBit();
+		}
+
+		if (Reader.IsError())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void UMovementPredictionSnapshots::ReceiveSnapshot(AMovementPredictionCharacter* LocalCharacter, const FMovementSnapshotPacket& Packet)
+{
+	// Unreliable, so they can arrive out of order - anything older than the newest is no use to us
+	if (Packet.SnapshotId <= NewestId)
+	{
+		return;
+	}
+
+	const FMovementSnapshot* Baseline = nullptr;
+	if (Packet.BaselineId != 0)
+	{
+		Baseline = FindSnapshot(Packet.BaselineId);
+		if (!Baseline || Packet.SnapshotId - Packet.BaselineId >= (uint32)SnapshotHistorySize)
+		{
+			// Don't ack it, the server keeps sending deltas against the last one we have until one gets through
+			return;
+		}
+	}
+
+	// Goes in the oldest slot, never the baseline's
+	FMovementSnapshot& Snapshot = History[Packet.SnapshotId % SnapshotHistorySize];
+	Snapshot.Id = 0;
+
+	FBitReader Reader(const_cast<uint8*>(Packet.Data.GetData()), Packet.Data.Num() * 8);
+	if (!ReadSnapshot(Reader, Baseline, Snapshot))
+	{
+		UE_LOG(LogMovementSnapshots, Warning, TEXT("Couldn't read snapshot %u (baseline %u, %d bytes)"), Packet.SnapshotId, Packet.BaselineId, Packet.Data.Num());
+		return;
+	}
+
+	Snapshot.Id = Packet.SnapshotId;
+	Snapshot.ServerTime = Packet.ServerTime;
+	NewestId = Packet.SnapshotId;
+
+	// Arrival time is a noisy read of the server's clock, average it out. Start over if the server's clock jumped.
+	const float Offset = Packet.ServerTime - GetWorld()->GetTimeSeconds();
+	if (!bHasServerTimeOffset || FMath::Abs(Offset - ServerTimeOffset) > 1.f)
+	{
+		ServerTimeOffset = Offset;
+		bHasServerTimeOffset = true;
+	}
+	else
+	{
+		ServerTimeOffset += (Offset - ServerTimeOffset) * 0.05f;
+	}
+
+	if (LocalCharacter)
+	{
+		LocalCharacter->ServerRPC_AckSnapshot(Packet.SnapshotId);
+	}
+
+	INC_DWORD_STAT(STAT_MovementPrediction_SnapshotsReceived);
+	CSV_CUSTOM_STAT(MovementPrediction, SnapshotsReceived, 1, ECsvCustomStatOp::Accumulate);
+}
+
+void UMovementPredictionSnapshots::AckSnapshot(AMovementPredictionCharacter* Viewer, uint32 SnapshotId)
+{
+	if (SnapshotId > NewestId)
+	{
+		return;
+	}
+
+	for (FSnapshotCharacter& Entry : Characters)
+	{
+		if (Entry.Character == Viewer)
+		{
+			Entry.LastAckedId = FMath::Max(Entry.LastAckedId, SnapshotId);
+			return;
+		}
+	}
+}
+
+void UMovementPredictionSnapshots::InterpolateCharacters()
+{
+	if (!bHasServerTimeOffset)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_SnapshotInterpolation);
+
+	// The two snapshots either side of the time we're showing
+	const float RenderTime = GetWorld()->GetTimeSeconds() + ServerTimeOffset - InterpolationDelay;
+	const FMovementSnapshot* From = nullptr;
+	const FMovementSnapshot* To = nullptr;
+	for (const FMovementSnapshot& Snapshot : History)
+	{
+		if (Snapshot.Id == 0)
+		{
+			continue;
+		}
+
+		if (Snapshot.ServerTime <= RenderTime)
+		{
+			if (!From || Snapshot.ServerTime > From->ServerTime)
+			{
+				From = &Snapshot;
+			}
+		}
+		else if (!To || Snapshot.ServerTime < To->ServerTime)
+		{
+			To = &Snapshot;
+		}
+	}
+
+	// Ran past the newest snapshot, the next one is late - hold everyone where it left them rather than guess
+	if (From && !To)
+	{
+		INC_DWORD_STAT(STAT_MovementPrediction_SnapshotBufferUnderruns);
+		CSV_CUSTOM_STAT(MovementPrediction, SnapshotBufferUnderruns, 1, ECsvCustomStatOp::Accumulate);
+	}
+
+	const FMovementSnapshot* A = From ? From : To;
+	const FMovementSnapshot* B = To ? To : From;
+	if (!A)
+	{
+		return;
+	}
+	const float Alpha = A != B ? FMath::Clamp((RenderTime - A->ServerTime) / (B->ServerTime - A->ServerTime), 0.f, 1.f) : 0.f;
+
+	for (const FSnapshotCharacter& Entry : Characters)
+	{
+		AMovementPredictionCharacter* Character = Entry.Character.Get();
+		UReallyCoolMovementComponent* Movement = Character ? Cast<UReallyCoolMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+		if (!Movement || Character->GetLocalRole() != ROLE_SimulatedProxy)
+		{
+			continue;
+		}
+
+		// The server turns bReplicateMovement off for characters it's sending in snapshots
+		const bool bInterpolated = !Character->IsReplicatingMovement();
+		if (Movement->IsSnapshotInterpolated() != bInterpolated)
+		{
+			Movement->SetSnapshotInterpolated(bInterpolated);
+		}
+
+		const FMovementSnapshotEntry* EntryA = bInterpolated ? A->FindEntry(Entry.CharacterId) : nullptr;
+		if (!EntryA)
+		{
+			continue;
+		}
+		const FMovementSnapshotEntry* EntryB = B->FindEntry(Entry.CharacterId);
+		if (!EntryB)
+		{
+			EntryB = EntryA;
+		}
+
+		const FVector Location = FMath::Lerp(FVector(EntryA->Location), FVector(EntryB->Location), Alpha) / SnapshotLocationScale;
+		const FVector Velocity = FMath::Lerp(FVector(EntryA->Velocity), FVector(EntryB->Velocity), Alpha);
+		const FQuat RotationA = FRotator(0.f, FRotator::DecompressAxisFromShort(EntryA->Yaw), 0.f).Quaternion();
+		const FQuat RotationB = FRotator(0.f, FRotator::DecompressAxisFromShort(EntryB->Yaw), 0.f).Quaternion();
+
+		Character->SetActorLocationAndRotation(Location, FQuat::Slerp(RotationA, RotationB, Alpha));
+		Movement->SetSnapshotState(Velocity, (Alpha < 0.5f ? EntryA : EntryB)->bDashing != 0);
+	}
+}
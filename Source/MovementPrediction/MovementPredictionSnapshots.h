@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "MovementPredictionSnapshots.generated.h"
+
+class AMovementPredictionCharacter;
+class FBitReader;
+class FBitWriter;
+
+/** One world snapshot on its way to one client, delta compressed against the last one that client acked */
+USTRUCT()
+struct FMovementSnapshotPacket
+{
+	GENERATED_BODY()
+
+	/** Counts up from 1 */
+	UPROPERTY()
+	uint32 SnapshotId;
+
+	/** Snapshot Data is a delta against, 0 when it's a full one */
+	UPROPERTY()
+	uint32 BaselineId;
+
+	/** Server world time the snapshot was taken at */
+	UPROPERTY()
+	float ServerTime;
+
+	/** Bit packed characters, see UMovementPredictionSnapshots::WriteSnapshot */
+	UPROPERTY()
+	TArray<uint8> Data;
+
+	FMovementSnapshotPacket()
+		: SnapshotId(0)
+		, BaselineId(0)
+		, ServerTime(0.f)
+	{
+	}
+};
+
+/** One character in a snapshot, quantized the way it's sent */
+struct FMovementSnapshotEntry
+{
+	uint16 CharacterId;
+
+	// Location in tenths of a unit, velocity in whole units per second
+	FIntVector Location;
+	FIntVector Velocity;
+
+	// Compressed actor yaw
+	uint16 Yaw;
+
+	// Only for animation, where the dash goes comes from Location
+	uint8 bDashing;
+};
+
+struct FMovementSnapshot
+{
+	/** 0 for an empty slot */
+	uint32 Id = 0;
+
+	float ServerTime = 0.f;
+
+	/** Sorted by CharacterId */
+	TArray<FMovementSnapshotEntry> Entries;
+
+	const FMovementSnapshotEntry* FindEntry(uint16 CharacterId) const;
+};
+
+/**
+ * Snapshot interpolation for remote characters, in place of each character replicating its own movement.
+ *
+ * The server takes a snapshot of every character's location, velocity and dash state SnapshotRate times a second and
+ * sends each client the other characters it has a channel open for, delta compressed against the last snapshot that client acked.
+ * Clients buffer the snapshots and place remote characters InterpolationDelay behind the newest, between the two
+ * snapshots either side, instead of simulating them. Owning clients still predict their own character as before.
+ *
+ * Off by default, see mp.Snapshots. The server switches every character's bReplicateMovement with it, which is how
+ * clients know which path their remote characters are on, so it can be flipped on a running server for A/B tests.
+ */
+UCLASS(config=Game)
+class UMovementPredictionSnapshots : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UMovementPredictionSnapshots();
+
+	// Begin USubsystem Interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End USubsystem Interface
+
+	// Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End FTickableGameObject Interface
+
+	/** If the server should send snapshots rather than replicate each character's movement */
+	static bool IsEnabled();
+
+	/** Server - gives Character its snapshot ID and starts sending it. Clients - lets snapshots place it. */
+	void RegisterCharacter(AMovementPredictionCharacter* Character);
+
+	void UnregisterCharacter(AMovementPredictionCharacter* Character);
+
+	/** Client only - a snapshot from the server, through our own character */
+	void ReceiveSnapshot(AMovementPredictionCharacter* LocalCharacter, const FMovementSnapshotPacket& Packet);
+
+	/** Server only - Viewer's client has SnapshotId, later snapshots to it are deltas against that one */
+	void AckSnapshot(AMovementPredictionCharacter* Viewer, uint32 SnapshotId);
+
+protected:
+
+	/** Snapshots sent per second */
+	UPROPERTY(config)
+	float SnapshotRate;
+
+	/** How far behind the newest snapshot clients place remote characters. Should cover a couple of snapshots plus jitter. */
+	UPROPERTY(config)
+	float InterpolationDelay;
+
+private:
+
+	/** Server only - snapshots everyone into the next history slot */
+	void TakeSnapshot();
+
+	/** Server only - sends the newest snapshot to every remote client */
+	void SendSnapshots();
+
+	/** Client only - places every remote character the snapshots cover */
+	void InterpolateCharacters();
+
+	/**
+	 * Writes the sorted CharacterIds' entries in Snapshot. Characters in BaselineIds, the ones the client was sent in
+	 * Baseline, are written as a delta against it, the rest in full.
+	 */
+	static void WriteSnapshot(FBitWriter& Writer, const FMovementSnapshot& Snapshot, const TArray<uint16>& CharacterIds, const FMovementSnapshot* Baseline, const TArray<uint16>* BaselineIds);
+
+	/** Reads what WriteSnapshot wrote into OutSnapshot's entries, returns false if the data is bad */
+	static bool ReadSnapshot(FBitReader& Reader, const FMovementSnapshot* Baseline, FMovementSnapshot& OutSnapshot);
+
+	/** The history slot holding Id, nullptr if it's been overwritten */
+	const FMovementSnapshot* FindSnapshot(uint32 Id) const;
+
+	/** Server only - the characters one client was sent in one snapshot, sorted */
+	struct FSentSnapshot
+	{
+		uint32 SnapshotId = 0;
+		TArray<uint16> CharacterIds;
+	};
+
+	struct FSnapshotCharacter
+	{
+		TWeakObjectPtr<AMovementPredictionCharacter> Character;
+
+		uint16 CharacterId;
+
+		// Server only - newest snapshot this character's client has acked
+		uint32 LastAckedId;
+
+		// Server only - what this character's client was sent, in the same slots as History
+		TArray<FSentSnapshot> SentSnapshots;
+	};
+
+	TArray<FSnapshotCharacter> Characters;
+
+	struct FFreedCharacterId
+	{
+		uint16 CharacterId;
+
+		// NewestId when its character unregistered
+		uint32 FreedAtSnapshotId;
+	};
+
+	/** Server only - IDs of unregistered characters, oldest first, waiting to be given out again */
+	TArray<FFreedCharacterId> FreedCharacterIds;
+
+	/** Ring of the last SnapshotHistorySize snapshots, taken on the server and received on clients */
+	TArray<FMovementSnapshot> History;
+
+	uint32 NewestId;
+
+	// Server only - time since the last snapshot, next ID to give a character, and whether characters replicate movement
+	float SnapshotTimeOwed;
+	uint16 NextCharacterId;
+	uint8 bSendingSnapshots : 1;
+
+	// Client only - server time minus our world time, smoothed over the snapshots received
+	float ServerTimeOffset;
+	uint8 bHasServerTimeOffset : 1;
+
+	// Scratch for SendSnapshots, kept to save reallocating every snapshot
+	FMovementSnapshotPacket Packet;
+};
@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementPredictionTrace.h"
+
+#if MOVEMENTPREDICTION_TRACE_ENABLED
+
+#include "HAL/IConsoleManager.h"
+
+bool FMovementPredictionTrace::bEnabled = false;
+
+static void OnTraceChanged(IConsoleVariable* Variable)
+{
+	FMovementPredictionTrace::SetEnabled(Variable->GetInt() != 0);
+}
+
+static int32 GMovementPredictionTrace = 0;
+static FAutoConsoleVariableRef CVarTrace(
+	TEXT("mp.Trace"),
+	GMovementPredictionTrace,
+	TEXT("MovementPrediction events in Unreal Insights captures, start the capture with -trace=cpu,frame as usual.\n")
+	TEXT("0: off, costs a branch per event (default)\n")
+	TEXT("1: saved moves, compressed flags, dash steps, client replays, server corrections and projectile spawns"),
+	FConsoleVariableDelegate::CreateStatic(&OnTraceChanged),
+	ECVF_Default);
+
+UE_TRACE_EVENT_BEGIN(MovementPrediction, SetMoveFor)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(float, TimeStamp)
+	UE_TRACE_EVENT_FIELD(float, DeltaTime)
+	UE_TRACE_EVENT_FIELD(float, DashTimeRemaining)
+	UE_TRACE_EVENT_FIELD(uint8, bWantsToDash)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(MovementPrediction, PrepMoveFor)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(float, TimeStamp)
+	UE_TRACE_EVENT_FIELD(float, DashTimeRemaining)
+	UE_TRACE_EVENT_FIELD(uint8, bWantsToDash)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(MovementPrediction, UpdateFromCompressedFlags)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(uint8, Flags)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(MovementPrediction, DashStep)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(float, TimeTick)
+	UE_TRACE_EVENT_FIELD(float, DashTimeRemaining)
+	UE_TRACE_EVENT_FIELD(uint8, bHit)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(MovementPrediction, ClientReplay)
+	UE_TRACE_EVENT_FIELD(uint64, StartCycle)
+	UE_TRACE_EVENT_FIELD(uint64, EndCycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(int32, NumMoves)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(MovementPrediction, ServerCorrection)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(float, TimeStamp)
+	UE_TRACE_EVENT_FIELD(float, Error)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(MovementPrediction, ProjectileSpawn)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(float, FastForwardSeconds)
+	UE_TRACE_EVENT_FIELD(uint8, bBatched)
+UE_TRACE_EVENT_END()
+
+static uint32 GetTraceObjectId(const UObject* Object)
+{
+	return Object ? Object->GetUniqueID() : 0;
+}
+
+void FMovementPredictionTrace::SetEnabled(bool bInEnabled)
+{
+	bEnabled = bInEnabled;
+	Trace::ToggleEvent(TEXT("MovementPrediction"), bInEnabled);
+}
+
+void FMovementPredictionTrace::OutputSetMoveFor(const UObject* Owner, float TimeStamp, float DeltaTime, float DashTimeRemaining, bool bWantsToDash)
+{
+	UE_TRACE_LOG(MovementPrediction, SetMoveFor)
+		<< SetMoveFor.Cycle(FPlatformTime::Cycles64())
+		<< SetMoveFor.ObjectId(GetTraceObjectId(Owner))
+		<< SetMoveFor.TimeStamp(TimeStamp)
+		<< SetMoveFor.DeltaTime(DeltaTime)
+		<< SetMoveFor.DashTimeRemaining(DashTimeRemaining)
+		<< SetMoveFor.bWantsToDash(bWantsToDash);
+}
+
+void FMovementPredictionTrace::OutputPrepMoveFor(const UObject* Owner, float TimeStamp, float DashTimeRemaining, bool bWantsToDash)
+{
+	UE_TRACE_LOG(MovementPrediction, PrepMoveFor)
+		<< PrepMoveFor.Cycle(FPlatformTime::Cycles64())
+		<< PrepMoveFor.ObjectId(GetTraceObjectId(Owner))
+		<< PrepMoveFor.TimeStamp(TimeStamp)
+		<< PrepMoveFor.DashTimeRemaining(DashTimeRemaining)
+		<< PrepMoveFor.bWantsToDash(bWantsToDash);
+}
+
+void FMovementPredictionTrace::OutputUpdateFromCompressedFlags(const UObject* Owner, uint8 Flags)
+{
+	UE_TRACE_LOG(MovementPrediction, UpdateFromCompressedFlags)
+		<< UpdateFromCompressedFlags.Cycle(FPlatformTime::Cycles64())
+		<< UpdateFromCompressedFlags.ObjectId(GetTraceObjectId(Owner))
+		<< UpdateFromCompressedFlags.Flags(Flags);
+}
+
+void FMovementPredictionTrace::OutputDashStep(const UObject* Owner, float TimeTick, float DashTimeRemaining, bool bHit)
+{
+	UE_TRACE_LOG(MovementPrediction, DashStep)
+		<< DashStep.Cycle(FPlatformTime::Cycles64())
+		<< DashStep.ObjectId(GetTraceObjectId(Owner))
+		<< DashStep.TimeTick(TimeTick)
+		<< DashStep.DashTimeRemaining(DashTimeRemaining)
+		<< DashStep.bHit(bHit);
+}
+
+void FMovementPredictionTrace::OutputClientReplay(const UObject* Owner, uint64 StartCycle, uint64 EndCycle, int32 NumMoves)
+{
+	UE_TRACE_LOG(MovementPrediction, ClientReplay)
+		<< ClientReplay.StartCycle(StartCycle)
+		<< ClientReplay.EndCycle(EndCycle)
+		<< ClientReplay.ObjectId(GetTraceObjectId(Owner))
+		<< ClientReplay.NumMoves(NumMoves);
+}
+
+void FMovementPredictionTrace::OutputServerCorrection(const UObject* Owner, float TimeStamp, float Error)
+{
+	UE_TRACE_LOG(MovementPrediction, ServerCorrection)
+		<< ServerCorrection.Cycle(FPlatformTime::Cycles64())
+		<< ServerCorrection.ObjectId(GetTraceObjectId(Owner))
+		<< ServerCorrection.TimeStamp(TimeStamp)
+		<< ServerCorrection.Error(Error);
+}
+
+void FMovementPredictionTrace::OutputProjectileSpawn(const UObject* Owner, bool bBatched, float FastForwardSeconds)
+{
+	UE_TRACE_LOG(MovementPrediction, ProjectileSpawn)
+		<< ProjectileSpawn.Cycle(FPlatformTime::Cycles64())
+		<< ProjectileSpawn.ObjectId(GetTraceObjectId(Owner))
+		<< ProjectileSpawn.FastForwardSeconds(FastForwardSeconds)
+		<< ProjectileSpawn.bBatched(bBatched);
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+
+// Compiled out wherever the engine compiles out tracing, and always in shipping
+#define MOVEMENTPREDICTION_TRACE_ENABLED (UE_TRACE_ENABLED && !UE_BUILD_SHIPPING)
+
+#if MOVEMENTPREDICTION_TRACE_ENABLED
+
+/**
+ * The MovementPrediction trace logger - timeline events for Unreal Insights, alongside the cpu and frame channels.
+ * Every event has the cycle it happened at and the unique ID of the object it happened to, so one character can be
+ * followed through a capture.
+ *
+ * Off until mp.Trace 1 (or -MPTrace=1), and while off each event is one branch on a bool. Use the TRACE_MOVEMENTPREDICTION_*
+ * macros, they go away entirely when tracing is compiled out.
+ */
+struct MOVEMENTPREDICTION_API FMovementPredictionTrace
+{
+	static void SetEnabled(bool bInEnabled);
+	static FORCEINLINE bool IsEnabled() { return bEnabled; }
+
+	static void OutputSetMoveFor(const UObject* Owner, float TimeStamp, float DeltaTime, float DashTimeRemaining, bool bWantsToDash);
+	static void OutputPrepMoveFor(const UObject* Owner, float TimeStamp, float DashTimeRemaining, bool bWantsToDash);
+	static void OutputUpdateFromCompressedFlags(const UObject* Owner, uint8 Flags);
+	static void OutputDashStep(const UObject* Owner, float TimeTick, float DashTimeRemaining, bool bHit);
+	static void OutputClientReplay(const UObject* Owner, uint64 StartCycle, uint64 EndCycle, int32 NumMoves);
+	static void OutputServerCorrection(const UObject* Owner, float TimeStamp, float Error);
+	static void OutputProjectileSpawn(const UObject* Owner, bool bBatched, float FastForwardSeconds);
+
+private:
+	static bool bEnabled;
+};
+
+#define TRACE_MOVEMENTPREDICTION_SET_MOVE_FOR(Owner, TimeStamp, DeltaTime, DashTimeRemaining, bWantsToDash) \
+	do { if (FMovementPredictionTrace::IsEnabled()) { FMovementPredictionTrace::OutputSetMoveFor(Owner, TimeStamp, DeltaTime, DashTimeRemaining, bWantsToDash); } } while (0)
+
+#define TRACE_MOVEMENTPREDICTION_PREP_MOVE_FOR(Owner, TimeStamp, DashTimeRemaining, bWantsToDash) \
+	do { if (FMovementPredictionTrace::IsEnabled()) { FMovementPredictionTrace::OutputPrepMoveFor(Owner, TimeStamp, DashTimeRemaining, bWantsToDash); } } while (0)
+
+#define TRACE_MOVEMENTPREDICTION_UPDATE_FROM_COMPRESSED_FLAGS(Owner, Flags) \
+	do { if (FMovementPredictionTrace::IsEnabled()) { FMovementPredictionTrace::OutputUpdateFromCompressedFlags(Owner, Flags); } } while (0)
+
+#define TRACE_MOVEMENTPREDICTION_DASH_STEP(Owner, TimeTick, DashTimeRemaining, bHit) \
+	do { if (FMovementPredictionTrace::IsEnabled()) { FMovementPredictionTrace::OutputDashStep(Owner, TimeTick, DashTimeRemaining, bHit); } } while (0)
+
+#define TRACE_MOVEMENTPREDICTION_CLIENT_REPLAY(Owner, StartCycle, EndCycle, NumMoves) \
+	do { if (FMovementPredictionTrace::IsEnabled()) { FMovementPredictionTrace::OutputClientReplay(Owner, StartCycle, EndCycle, NumMoves); } } while (0)
+
+#define TRACE_MOVEMENTPREDICTION_SERVER_CORRECTION(Owner, TimeStamp, Error) \
+	do { if (FMovementPredictionTrace::IsEnabled()) { FMovementPredictionTrace::OutputServerCorrection(Owner, TimeStamp, Error); } } while (0)
+
+#define TRACE_MOVEMENTPREDICTION_PROJECTILE_SPAWN(Owner, bBatched, FastForwardSeconds) \
+	do { if (FMovementPredictionTrace::IsEnabled()) { FMovementPredictionTrace::OutputProjectileSpawn(Owner, bBatched, FastForwardSeconds); } } while (0)
+
+#else
+
+#define TRACE_MOVEMENTPREDICTION_SET_MOVE_FOR(Owner, TimeStamp, DeltaTime, DashTimeRemaining, bWantsToDash)
+#define TRACE_MOVEMENTPREDICTION_PREP_MOVE_FOR(Owner, TimeStamp, DashTimeRemaining, bWantsToDash)
+#define TRACE_MOVEMENTPREDICTION_UPDATE_FROM_COMPRESSED_FLAGS(Owner, Flags)
+#define TRACE_MOVEMENTPREDICTION_DASH_STEP(Owner, TimeTick, DashTimeRemaining, bHit)
+#define TRACE_MOVEMENTPREDICTION_CLIENT_REPLAY(Owner, StartCycle, EndCycle, NumMoves)
+#define TRACE_MOVEMENTPREDICTION_SERVER_CORRECTION(Owner, TimeStamp, Error)
+#define TRACE_MOVEMENTPREDICTION_PROJECTILE_SPAWN(Owner, bBatched, FastForwardSeconds)
+
+#endif
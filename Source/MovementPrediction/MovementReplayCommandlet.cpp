@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementReplayCommandlet.h"
+#include "MovementPredictionCharacter.h"
+#include "MovementStreamRecorder.h"
+#include "ReallyCoolMovementComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "Templates/Atomic.h"
+#include "UObject/Package.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMovementReplay, Log, All);
+
+/** Counts game thread allocations while it's installed as GMalloc, everything else goes straight through */
+class FCountingMalloc final : public FMalloc
+{
+public:
+	explicit FCountingMalloc(FMalloc* InInner)
+		: Inner(InInner)
+		, NumAllocations(0)
+	{
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override
+	{
+		Inner->Free(Original);
+	}
+
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+	{
+		return Inner->QuantizeSize(Count, Alignment);
+	}
+
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+	{
+		return Inner->GetAllocationSize(Original, SizeOut);
+	}
+
+	virtual void Trim(bool bTrimThreadCaches) override
+	{
+		Inner->Trim(bTrimThreadCaches);
+	}
+
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		return Inner->IsInternallyThreadSafe();
+	}
+
+	virtual const TCHAR* GetDescriptiveName() override
+	{
+		return TEXT("CountingMalloc");
+	}
+
+	uint64 GetNumAllocations() const
+	{
+		return NumAllocations.Load();
+	}
+
+private:
+	void CountAllocation()
+	{
+		if (IsInGameThread())
+		{
+			++NumAllocations;
+		}
+	}
+
+	FMalloc* Inner;
+	TAtomic<uint64> NumAllocations;
+};
+
+UMovementReplayCommandlet::UMovementReplayCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UMovementReplayCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamVals;
+	ParseCommandLine(*Params, Tokens, Switches, ParamVals);
+
+	const FString StreamFile = ParamVals.FindRef(TEXT("Stream"));
+	const FString MapName = ParamVals.Contains(TEXT("Map")) ? ParamVals[TEXT("Map")] : TEXT("/Game/FirstPersonCPP/Maps/FirstPersonExampleMap");
+	const FString PawnClassName = ParamVals.Contains(TEXT("Pawn")) ? ParamVals[TEXT("Pawn")] : TEXT("/Game/FirstPersonCPP/Blueprints/FirstPersonCharacter.FirstPersonCharacter_C");
+	const int32 Iterations = ParamVals.Contains(TEXT("Iterations")) ? FMath::Max(FCString::Atoi(*ParamVals[TEXT("Iterations")]), 1) : 10;
+	const float MaxDivergence = ParamVals.Contains(TEXT("MaxDivergence")) ? FCString::Atof(*ParamVals[TEXT("MaxDivergence")]) : 1.f;
+
+	FRecordedMoveStream Stream;
+	if (StreamFile.IsEmpty() || !Stream.LoadFromFile(StreamFile))
+	{
+		UE_LOG(LogMovementReplay, Error, TEXT("Couldn't load move stream '%s', record one with mp.RecordMoves and pass it with -Stream=<file>"), *StreamFile);
+		return 1;
+	}
+
+	if (Stream.Moves.Num() == 0)
+	{
+		UE_LOG(LogMovementReplay, Error, TEXT("Move stream '%s' is empty"), *StreamFile);
+		return 1;
+	}
+
+	UClass* PawnClass = LoadClass<AMovementPredictionCharacter>(nullptr, *PawnClassName);
+	UPackage* MapPackage = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = MapPackage ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+	if (!PawnClass || !World)
+	{
+		UE_LOG(LogMovementReplay, Error, TEXT("Couldn't load pawn class '%s' or map '%s'"), *PawnClassName, *MapName);
+		return 1;
+	}
+
+	// A standalone game world with collision, nothing networked
+	World->AddToRoot();
+	World->WorldType = EWorldType::Game;
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues().AllowAudioPlayback(false).CreatePhysicsScene(true));
+	}
+	World->UpdateWorldComponents(true, true);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AMovementPredictionCharacter* Character = World->SpawnActor<AMovementPredictionCharacter>(PawnClass, Stream.StartLocation, Stream.StartRotation, SpawnParams);
+	UReallyCoolMovementComponent* Movement = Character ? Cast<UReallyCoolMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+	if (!Movement)
+	{
+		UE_LOG(LogMovementReplay, Error, TEXT("Couldn't spawn '%s' with a UReallyCoolMovementComponent"), *PawnClassName);
+		return 1;
+	}
+
+	// One untimed pass to warm up caches and any lazily allocated state
+	Movement->ResetForReplay(Stream);
+	for (const FRecordedMove& Move : Stream.Moves)
+	{
+		Movement->ReplayRecordedMove(Move);
+	}
+
+	uint64 TotalCycles = 0;
+	uint64 TotalAllocations = 0;
+	float MaxMoveDivergence = 0.f;
+	float MaxFinalDivergence = 0.f;
+	float MaxIterationSpread = 0.f;
+	TOptional<FVector> FirstFinalLocation;
+
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		Movement->ResetForReplay(Stream);
+
+		FMalloc* OriginalMalloc = GMalloc;
+		FCountingMalloc CountingMalloc(OriginalMalloc);
+		GMalloc = &CountingMalloc;
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (const FRecordedMove& Move : Stream.Moves)
+		{
+			Movement->ReplayRecordedMove(Move);
+		}
+		TotalCycles += FPlatformTime::Cycles64() - StartCycles;
+
+		GMalloc = OriginalMalloc;
+		TotalAllocations += CountingMalloc.GetNumAllocations();
+
+		// Divergence is checked in a separate pass so it doesn't count towards the timing
+		Movement->ResetForReplay(Stream);
+		for (const FRecordedMove& Move : Stream.Moves)
+		{
+			Movement->ReplayRecordedMove(Move);
+			MaxMoveDivergence = FMath::Max(MaxMoveDivergence, FVector::Dist(Movement->UpdatedComponent->GetComponentLocation(), Move.EndLocation));
+		}
+
+		const FVector FinalLocation = Movement->UpdatedComponent->GetComponentLocation();
+		MaxFinalDivergence = FMath::Max(MaxFinalDivergence, FVector::Dist(FinalLocation, Stream.Moves.Last().EndLocation));
+
+		// Replays of the same stream should land in exactly the same place every time
+		if (!FirstFinalLocation.IsSet())
+		{
+			FirstFinalLocation = FinalLocation;
+		}
+		MaxIterationSpread = FMath::Max(MaxIterationSpread, FVector::Dist(FinalLocation, FirstFinalLocation.GetValue()));
+	}
+
+	const double NumSimulatedMoves = double(Stream.Moves.Num()) * Iterations;
+	const double NsPerMove = FPlatformTime::ToSeconds64(TotalCycles) * 1.0e9 / NumSimulatedMoves;
+	const double AllocationsPerMove = double(TotalAllocations) / NumSimulatedMoves;
+
+	UE_LOG(LogMovementReplay, Display, TEXT("Replayed %d moves x %d iterations from %s"), Stream.Moves.Num(), Iterations, *StreamFile);
+	UE_LOG(LogMovementReplay, Display, TEXT("  %.0f ns per move, %.2f allocations per move"), NsPerMove, AllocationsPerMove);
+	UE_LOG(LogMovementReplay, Display, TEXT("  divergence from client: %.3f uu final, %.3f uu worst move"), MaxFinalDivergence, MaxMoveDivergence);
+	UE_LOG(LogMovementReplay, Display, TEXT("  spread between iterations: %.3f uu"), MaxIterationSpread);
+
+	Character->Destroy();
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+
+	if (MaxIterationSpread > KINDA_SMALL_NUMBER || MaxFinalDivergence > MaxDivergence)
+	{
+		UE_LOG(LogMovementReplay, Error, TEXT("Replay isn't deterministic or diverged more than %.3f uu"), MaxDivergence);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MovementReplayCommandlet.generated.h"
+
+/**
+ * Replays a move stream recorded with mp.RecordMoves against UReallyCoolMovementComponent on a map, with no networking.
+ * Reports ns and allocations per simulated move and how far the replay ends up from where the client did.
+ *
+ * UE4Editor-Cmd MovementPrediction.uproject -run=MovementReplay -Stream=<file> [-Map=<map>] [-Pawn=<class>] [-Iterations=N] [-MaxDivergence=<uu>]
+ */
+UCLASS()
+class UMovementReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMovementReplayCommandlet();
+
+	// Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	// End UCommandlet Interface
+};
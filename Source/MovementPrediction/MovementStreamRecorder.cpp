@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementStreamRecorder.h"
+#include "ReallyCoolMovementComponent.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Misc/FileHelper.h"
+
+// 'MPMS'
+static const uint32 MoveStreamMagic = 0x4D504D53;
+// 2: the start state is every predicted field, including the dash input
+static const uint32 MoveStreamVersion = 2;
+
+FRecordedMoveStream::FRecordedMoveStream()
+	: StartLocation(FVector::ZeroVector)
+	, StartRotation(FRotator::ZeroRotator)
+	, StartVelocity(FVector::ZeroVector)
+	, StartPackedMovementMode(0)
+	, StartState()
+{
+}
+
+void FRecordedMoveStream::Serialize(FArchive& Ar)
+{
+	Ar << StartLocation << StartRotation << StartVelocity << StartPackedMovementMode;
+	UReallyCoolMovementComponent::FPredictedFields::Serialize(Ar, StartState);
+	Ar << Moves;
+}
+
+bool FRecordedMoveStream::LoadFromFile(const FString& Filename)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Filename))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Reader << Magic << Version;
+	if (Magic != MoveStreamMagic || Version != MoveStreamVersion)
+	{
+		return false;
+	}
+
+	Serialize(Reader);
+	return !Reader.IsError();
+}
+
+bool FRecordedMoveStream::SaveToFile(const FString& Filename)
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	uint32 Magic = MoveStreamMagic;
+	uint32 Version = MoveStreamVersion;
+	Writer << Magic << Version;
+	Serialize(Writer);
+
+	return FFileHelper::SaveArrayToFile(Data, *Filename);
+}
+
+FMovementStreamRecorder::FMovementStreamRecorder(const FString& InFilename)
+	: Filename(InFilename)
+{
+	// About a minute at 120 moves a second, so recording doesn't show up in the frame
+	Stream.Moves.Reserve(120 * 60);
+}
+
+void FMovementStreamRecorder::RecordMove(const FSavedMove_ReallyCoolMovez& Move)
+{
+	if (Stream.Moves.Num() == 0)
+	{
+		Stream.StartLocation = Move.StartLocation;
+		Stream.StartRotation = Move.StartRotation;
+		Stream.StartVelocity = Move.StartVelocity;
+		Stream.StartPackedMovementMode = Move.StartPackedMovementMode;
+		Stream.StartState = Move.SavedState;
+	}
+
+	FRecordedMove& Recorded = Stream.Moves.AddDefaulted_GetRef();
+	Recorded.TimeStamp = Move.TimeStamp;
+	Recorded.DeltaTime = Move.DeltaTime;
+	Recorded.Acceleration = Move.Acceleration;
+	Recorded.EndLocation = Move.SavedLocation;
+	Recorded.DashYaw = Move.SavedState.DashYaw;
+	Recorded.CompressedFlags = Move.GetCompressedFlags();
+}
+
+bool FMovementStreamRecorder::Finish()
+{
+	return Stream.SaveToFile(Filename);
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SavedMoveFields.h"
+
+class FSavedMove_ReallyCoolMovez;
+
+/** One move exactly as the client sent it to the server */
+struct FRecordedMove
+{
+	float TimeStamp;
+	float DeltaTime;
+	FVector Acceleration;
+
+	// Where the client ended up after the move, to measure replay divergence against
+	FVector EndLocation;
+
+	uint16 DashYaw;
+	uint8 CompressedFlags;
+
+	friend FArchive& operator<<(FArchive& Ar, FRecordedMove& Move)
+	{
+		Ar << Move.TimeStamp << Move.DeltaTime << Move.Acceleration << Move.EndLocation << Move.DashYaw << Move.CompressedFlags;
+		return Ar;
+	}
+};
+
+/** A recorded move stream and the state it started from */
+struct FRecordedMoveStream
+{
+	FVector StartLocation;
+	FRotator StartRotation;
+	FVector StartVelocity;
+	uint8 StartPackedMovementMode;
+
+	// In case we started recording mid-dash
+	FReallyCoolSavedState StartState;
+
+	TArray<FRecordedMove> Moves;
+
+	FRecordedMoveStream();
+
+	/** Loads a stream written by FMovementStreamRecorder, returns false if the file is missing or not a move stream */
+	bool LoadFromFile(const FString& Filename);
+
+	/** Writes the stream in our compact binary format */
+	bool SaveToFile(const FString& Filename);
+
+	void Serialize(FArchive& Ar);
+};
+
+/**
+ * Records the moves a locally controlled UReallyCoolMovementComponent sends to the server,
+ * so they can be replayed offline by UMovementReplayCommandlet.
+ * Start and stop with "mp.RecordMoves <file>" / "mp.RecordMoves".
+ */
+class FMovementStreamRecorder
+{
+public:
+	explicit FMovementStreamRecorder(const FString& InFilename);
+
+	/** Appends a move we're sending to the server, the first one also sets the start state */
+	void RecordMove(const FSavedMove_ReallyCoolMovez& Move);
+
+	/** Writes everything recorded so far, returns false if the file couldn't be written */
+	bool Finish();
+
+	int32 GetNumMoves() const { return Stream.Moves.Num(); }
+
+private:
+	FString Filename;
+	FRecordedMoveStream Stream;
+};
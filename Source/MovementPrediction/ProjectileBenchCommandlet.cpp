@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileBenchCommandlet.h"
+#include "MovementPredictionProjectile.h"
+#include "MovementPredictionProjectileManager.h"
+#include "MovementPredictionProjectilePool.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "UObject/Package.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogProjectileBench, Log, All);
+
+namespace ProjectileBench
+{
+	const float DeltaTime = 1.f / 60.f;
+
+	/** Same volley for every run, up and out from Origin so most rounds bounce off the floor a few times */
+	void MakeVolley(int32 Count, TArray<FRotator>& OutRotations)
+	{
+		FRandomStream Random(1234);
+		OutRotations.Reset(Count);
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			OutRotations.Add(FRotator(Random.FRandRange(-30.f, 45.f), Random.FRandRange(0.f, 360.f), 0.f));
+		}
+	}
+
+	/** Ticks World Frames times, the projectile manager ticks with it, returns the cycles spent */
+	uint64 TickFrames(UWorld* World, int32 Frames)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Frame = 0; Frame < Frames; ++Frame)
+		{
+			World->Tick(LEVELTICK_All, DeltaTime);
+			GFrameCounter++;
+		}
+		return FPlatformTime::Cycles64() - StartCycles;
+	}
+}
+
+UProjectileBenchCommandlet::UProjectileBenchCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UProjectileBenchCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamVals;
+	ParseCommandLine(*Params, Tokens, Switches, ParamVals);
+
+	const FString MapName = ParamVals.Contains(TEXT("Map")) ? ParamVals[TEXT("Map")] : TEXT("/Game/FirstPersonCPP/Maps/FirstPersonExampleMap");
+	const FString ProjectileClassName = ParamVals.Contains(TEXT("Projectile")) ? ParamVals[TEXT("Projectile")] : TEXT("/Game/FirstPersonCPP/Blueprints/FirstPersonProjectile.FirstPersonProjectile_C");
+	const int32 Count = ParamVals.Contains(TEXT("Count")) ? FMath::Max(FCString::Atoi(*ParamVals[TEXT("Count")]), 1) : 500;
+	int32 Frames = ParamVals.Contains(TEXT("Frames")) ? FMath::Max(FCString::Atoi(*ParamVals[TEXT("Frames")]), 1) : 120;
+	FVector Origin(0.f, 0.f, 300.f);
+	if (ParamVals.Contains(TEXT("Origin")))
+	{
+		Origin.InitFromString(ParamVals[TEXT("Origin")]);
+	}
+
+	UClass* ProjectileClass = LoadClass<AMovementPredictionProjectile>(nullptr, *ProjectileClassName);
+	UPackage* MapPackage = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = MapPackage ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+	if (!ProjectileClass || !World)
+	{
+		UE_LOG(LogProjectileBench, Error, TEXT("Couldn't load projectile class '%s' or map '%s'"), *ProjectileClassName, *MapName);
+		return 1;
+	}
+
+	// Every projectile should live through every timed frame, otherwise later frames time fewer of them
+	const float LifeSpan = ProjectileClass->GetDefaultObject<AMovementPredictionProjectile>()->InitialLifeSpan;
+	if (LifeSpan > 0.f)
+	{
+		Frames = FMath::Min(Frames, FMath::FloorToInt(LifeSpan / ProjectileBench::DeltaTime) - 1);
+	}
+
+	// A standalone game world that ticks, nothing networked
+	World->AddToRoot();
+	World->WorldType = EWorldType::Game;
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues().AllowAudioPlayback(false).CreatePhysicsScene(true));
+	}
+	World->UpdateWorldComponents(true, true);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	UMovementPredictionProjectilePool* Pool = World->GetSubsystem<UMovementPredictionProjectilePool>();
+	UMovementPredictionProjectileManager* Manager = World->GetSubsystem<UMovementPredictionProjectileManager>();
+	if (!Pool || !Manager)
+	{
+		UE_LOG(LogProjectileBench, Error, TEXT("World has no projectile pool or manager"));
+		return 1;
+	}
+
+	TArray<FRotator> Volley;
+	ProjectileBench::MakeVolley(Count, Volley);
+
+	// The world on its own, taken off both runs below
+	ProjectileBench::TickFrames(World, 10);
+	const uint64 BaselineCycles = ProjectileBench::TickFrames(World, Frames);
+
+	// Pooled actors, spawned ahead so only the simulation is timed
+	for (const FRotator& Rotation : Volley)
+	{
+		Pool->Acquire(ProjectileClass, Origin, Rotation);
+	}
+	const uint64 ActorCycles = ProjectileBench::TickFrames(World, Frames);
+
+	// Let every actor run out of life and go back to the pool before the batched run
+	ProjectileBench::TickFrames(World, FMath::CeilToInt(FMath::Max(LifeSpan, 0.f) / ProjectileBench::DeltaTime) + 1);
+
+	for (const FRotator& Rotation : Volley)
+	{
+		Manager->Launch(ProjectileClass, Origin, Rotation);
+	}
+	const uint64 BatchedCycles = ProjectileBench::TickFrames(World, Frames);
+
+	const double BaselineMs = FPlatformTime::ToMilliseconds64(BaselineCycles);
+	const double ActorMs = FMath::Max(FPlatformTime::ToMilliseconds64(ActorCycles) - BaselineMs, 0.001);
+	const double BatchedMs = FMath::Max(FPlatformTime::ToMilliseconds64(BatchedCycles) - BaselineMs, 0.001);
+	const double ProjectileFrames = double(Count) * Frames;
+
+	UE_LOG(LogProjectileBench, Display, TEXT("%d projectiles x %d frames on %s (world alone %.3f ms/frame)"), Count, Frames, *MapName, BaselineMs / Frames);
+	UE_LOG(LogProjectileBench, Display, TEXT("  pooled actors: %.3f ms/frame, %.0f projectiles/ms"), ActorMs / Frames, ProjectileFrames / ActorMs);
+	UE_LOG(LogProjectileBench, Display, TEXT("  batched:       %.3f ms/frame, %.0f projectiles/ms, %d promoted to actors"), BatchedMs / Frames, ProjectileFrames / BatchedMs, Count - Manager->GetNumProjectiles());
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+
+	return 0;
+}
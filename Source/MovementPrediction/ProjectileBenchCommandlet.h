@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ProjectileBenchCommandlet.generated.h"
+
+/**
+ * Fires the same volley of projectiles as pooled actors and through UMovementPredictionProjectileManager on a map,
+ * ticks the world at a fixed step and reports projectiles simulated per ms of game thread time for each.
+ *
+ * UE4Editor-Cmd MovementPrediction.uproject -run=ProjectileBench [-Map=<map>] [-Projectile=<class>] [-Count=N] [-Frames=N] [-Origin=X,Y,Z]
+ */
+UCLASS()
+class UProjectileBenchCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UProjectileBenchCommandlet();
+
+	// Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	// End UCommandlet Interface
+};
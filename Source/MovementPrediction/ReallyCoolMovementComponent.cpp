@@ -3,15 +3,90 @@
 
 #include "ReallyCoolMovementComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "MovementPrediction.h"
 #include "MovementPredictionCharacter.h"
+#include "MovementPredictionServerMoveBatch.h"
+#include "MovementPredictionTrace.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogReallyCoolMovement, Log, All);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Saved Moves Pending"), STAT_MovementPrediction_SavedMovesPending, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Moves Combined"), STAT_MovementPrediction_MovesCombined, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("ServerMoves Sent"), STAT_MovementPrediction_ServerMovesSent, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Corrections Received"), STAT_MovementPrediction_CorrectionsReceived, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Moves Replayed"), STAT_MovementPrediction_MovesReplayed, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dash Mispredictions"), STAT_MovementPrediction_DashMispredictions, STATGROUP_MovementPrediction);
+DECLARE_CYCLE_STAT(TEXT("Client Replay"), STAT_MovementPrediction_ClientReplay, STATGROUP_MovementPrediction);
+DECLARE_CYCLE_STAT(TEXT("Server Process Moves"), STAT_MovementPrediction_ServerProcessMoves, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Move Buffer Depth"), STAT_MovementPrediction_ServerMoveBufferDepth, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Move Buffer Underruns"), STAT_MovementPrediction_ServerMoveBufferUnderruns, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Moves Respaced"), STAT_MovementPrediction_ServerMovesRespaced, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dash Corrections Suppressed"), STAT_MovementPrediction_DashCorrectionsSuppressed, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Corrections Blended"), STAT_MovementPrediction_CorrectionsBlended, STATGROUP_MovementPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Precomputed Floors Used"), STAT_MovementPrediction_PrecomputedFloorsUsed, STATGROUP_MovementPrediction);
+
+static TAutoConsoleVariable<int32> CVarServerMoveBuffer(
+	TEXT("mp.ServerMoveBuffer"),
+	0,
+	TEXT("How the server processes ServerMoves from remote clients.\n")
+	TEXT("0: as soon as they arrive (default)\n")
+	TEXT("1: queued and played out at a steady rate, a little behind the newest move depending on how unevenly they arrive"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarSoftCorrections(
+	TEXT("mp.SoftCorrections"),
+	0,
+	TEXT("How small movement errors are handled, on whichever side sets it.\n")
+	TEXT("0: the engine's error limit, every correction is replayed (default)\n")
+	TEXT("1: the server lets dash moves within DashPositionTolerance/DashVelocityTolerance through, clients blend out corrections within ClientErrorBlendDistance instead of replaying"),
+	ECVF_Default);
+
+// How far the server can end a move from where the client said it did and still use the floor looked up there.
+// ClientLoc is rounded to 0.01, so this only covers moves the client predicted right.
+static const float PrecomputedFloorTolerance = 0.02f;
+
+// What ServerMoveDual sends as the first move's ClientLoc, it has none of its own and the engine never checks it
+static const FVector DualMovePendingClientLoc(1.f, 2.f, 3.f);
+
+// Slack on top of MaxSavedMoveCount for the pending, last acked and in-flight moves
+static const int32 ExtraPooledMoves = 4;
+
+static void RecordMoves(const TArray<FString>& Args, UWorld* World)
+{
+	APlayerController* PC = World ? World->GetFirstPlayerController() : nullptr;
+	ACharacter* Character = PC ? Cast<ACharacter>(PC->GetPawn()) : nullptr;
+	UReallyCoolMovementComponent* Movement = Character ? Cast<UReallyCoolMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+	if (!Movement)
+	{
+		UE_LOG(LogReallyCoolMovement, Warning, TEXT("mp.RecordMoves: no locally controlled character to record"));
+		return;
+	}
+
+	if (Args.Num() > 0)
+	{
+		Movement->StartMoveRecording(Args[0]);
+	}
+	else
+	{
+		Movement->StopMoveRecording();
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs RecordMovesCommand(
+	TEXT("mp.RecordMoves"),
+	TEXT("mp.RecordMoves <file> records the moves the local player sends to the server, mp.RecordMoves on its own stops and writes the file"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RecordMoves));
 
 void FSavedMove_ReallyCoolMovez::Clear()
 {
 	Super::Clear();
 
-	bSavedWantsToDash = false;
-	SavedDashTimeRemaining = 0.f;
-	SavedDashDir = FVector::ZeroVector;
+	SavedState = FReallyCoolSavedState();
+	SavedCorrectionBlendApplied = FVector::ZeroVector;
 }
 
 uint8 FSavedMove_ReallyCoolMovez::GetCompressedFlags() const
@@ -19,7 +94,7 @@ uint8 FSavedMove_ReallyCoolMovez::GetCompressedFlags() const
 	uint8 Result = Super::GetCompressedFlags();
 
 	// Compress our custom flag into the result if set
-	if (bSavedWantsToDash)
+	if (SavedState.bWantsToDash)
 	{
 		Result |= FSavedMove_Character::FLAG_Custom_0;
 	}
@@ -29,23 +104,41 @@ uint8 FSavedMove_ReallyCoolMovez::GetCompressedFlags() const
 
 bool FSavedMove_ReallyCoolMovez::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* Character, float MaxDelta) const
 {
+	const FSavedMove_ReallyCoolMovez* NewCoolMove = static_cast<const FSavedMove_ReallyCoolMovez*>(NewMove.Get());
+
 	// Engine tries to combine moves for optimization purposes. If we differ from the new move, we probably shouldn't combine them.
-	if (bSavedWantsToDash != ((FSavedMove_ReallyCoolMovez*)&NewMove)->bSavedWantsToDash)
+	if (!UReallyCoolMovementComponent::FPredictedFields::CanCombine(SavedState, NewCoolMove->SavedState))
 	{
 		return false;
 	}
 
-	if (SavedDashTimeRemaining != ((FSavedMove_ReallyCoolMovez*)&NewMove)->SavedDashTimeRemaining)
-	{
-		return false;
-	}
+	return Super::CanCombineWith(NewMove, Character, MaxDelta);
+}
+
+void FSavedMove_ReallyCoolMovez::CombineWith(const FSavedMove_Character* OldMove, ACharacter* InCharacter, APlayerController* PC, const FVector& OldStartLocation)
+{
+	Super::CombineWith(OldMove, InCharacter, PC, OldStartLocation);
+
+	const FSavedMove_ReallyCoolMovez* OldCoolMove = static_cast<const FSavedMove_ReallyCoolMovez*>(OldMove);
 
-	if (SavedDashDir != ((FSavedMove_ReallyCoolMovez*)&NewMove)->SavedDashDir)
+	// The combined move starts where the old one did
+	SavedState.DashTimeRemaining = OldCoolMove->SavedState.DashTimeRemaining;
+
+	UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(InCharacter->GetCharacterMovement());
+	if (Movement)
 	{
-		return false;
-	}
+		Movement->DashTimeRemaining = OldCoolMove->SavedState.DashTimeRemaining;
 
-	return Super::CanCombineWith(NewMove, Character, MaxDelta);
+		FNetworkPredictionData_Client_ReallyCoolMovez* ClientData = static_cast<FNetworkPredictionData_Client_ReallyCoolMovez*>(Movement->GetPredictionData_Client());
+		++ClientData->NumCombinedMoves;
+		if (SavedState.DashTimeRemaining > 0.f)
+		{
+			++ClientData->NumCombinedDashMoves;
+		}
+
+		INC_DWORD_STAT(STAT_MovementPrediction_MovesCombined);
+		CSV_CUSTOM_STAT(MovementPrediction, MovesCombined, 1, ECsvCustomStatOp::Accumulate);
+	}
 }
 
 void FSavedMove_ReallyCoolMovez::SetMoveFor(ACharacter* Character, float InDeltaTime, const FVector& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
@@ -58,9 +151,9 @@ void FSavedMove_ReallyCoolMovez::SetMoveFor(ACharacter* Character, float InDelta
 	if (Movement)
 	{
 		// Save the state from the player's input, set on movement component
-		bSavedWantsToDash = Movement->bWantsToDash;
-		SavedDashTimeRemaining = Movement->DashTimeRemaining;
-		SavedDashDir = Movement->DashDir;
+		UReallyCoolMovementComponent::FPredictedFields::Save(SavedState, *Movement);
+		SavedCorrectionBlendApplied = Movement->CorrectionBlendApplied;
+		TRACE_MOVEMENTPREDICTION_SET_MOVE_FOR(Movement, TimeStamp, InDeltaTime, SavedState.DashTimeRemaining, SavedState.bWantsToDash != 0);
 	}
 }
 
@@ -75,20 +168,83 @@ void FSavedMove_ReallyCoolMovez::PrepMoveFor(ACharacter* Character)
 	UReallyCoolMovementComponent* Movement = Cast<UReallyCoolMovementComponent>(Character->GetCharacterMovement());
 	if (Movement)
 	{
-		Movement->DashTimeRemaining = SavedDashTimeRemaining;
-		Movement->DashDir = SavedDashDir;
+		TRACE_MOVEMENTPREDICTION_PREP_MOVE_FOR(Movement, TimeStamp, SavedState.DashTimeRemaining, SavedState.bWantsToDash != 0);
+
+		const uint16 OldDashYaw = Movement->DashYaw;
+		UReallyCoolMovementComponent::FPredictedFields::Restore(SavedState, *Movement);
+		if (Movement->DashYaw != OldDashYaw)
+		{
+			Movement->DashDir = UReallyCoolMovementComponent::DecompressDashDir(Movement->DashYaw);
+		}
 	}
 }
 
 FNetworkPredictionData_Client_ReallyCoolMovez::FNetworkPredictionData_Client_ReallyCoolMovez(const UCharacterMovementComponent& ClientMovement)
 	: Super(ClientMovement)
+	, NumCombinedMoves(0)
+	, NumCombinedDashMoves(0)
+	, NumServerMovesSent(0)
+	, NumCorrectionsReceived(0)
+	, NumDashMispredictions(0)
+	, LastCorrectionError(0.f)
+	, NumCorrectionsBlended(0)
+	, ClientReplayCycles(0)
+	, SmoothedRoundTripTime(0.f)
+	, RoundTripTimeVariation(0.f)
+	, NumRoundTripSamples(0)
+	, MovePoolHighWaterMark(0)
+	, MovePoolOverflowCount(0)
+{
+	LLM_SCOPE_MOVEMENTPREDICTION(SavedMoves);
+
+	// Size the pool so the saved, pending and acked moves all fit, and never let the engine throw pooled moves away.
+	// Once every slot has been wrapped in a FSavedMovePtr once, the engine recycles them through FreeMoves and we stop allocating.
+	const int32 PoolCapacity = MaxSavedMoveCount + ExtraPooledMoves;
+	MaxFreeMoveCount = PoolCapacity;
+
+	MovePool.SetNum(PoolCapacity);
+	FreeMovePoolSlots.Reserve(PoolCapacity);
+	for (int32 SlotIndex = PoolCapacity - 1; SlotIndex >= 0; --SlotIndex)
+	{
+		FreeMovePoolSlots.Add(SlotIndex);
+	}
+}
+
+FNetworkPredictionData_Client_ReallyCoolMovez::~FNetworkPredictionData_Client_ReallyCoolMovez()
 {
+	UE_LOG(LogReallyCoolMovement, Log, TEXT("Saved move pool: high-water mark %d/%d, %d overflow allocations, %llu bytes"),
+		MovePoolHighWaterMark, MovePool.Num(), MovePoolOverflowCount, (uint64)GetMovePoolAllocatedSize());
+	UE_LOG(LogReallyCoolMovement, Log, TEXT("Saved moves: %u ServerMoves sent, %u moves combined (%u mid-dash), %u corrections (%u mid-dash, %u blended), %.3f ms replaying"),
+		NumServerMovesSent, NumCombinedMoves, NumCombinedDashMoves, NumCorrectionsReceived, NumDashMispredictions, NumCorrectionsBlended, FPlatformTime::ToMilliseconds64(ClientReplayCycles));
 
+	// Release every move before the pool goes away - the base destructor runs after our members are destroyed
+	SavedMoves.Empty();
+	FreeMoves.Empty();
+	PendingMove = nullptr;
+	LastAckedMove = nullptr;
 }
 
 FSavedMovePtr FNetworkPredictionData_Client_ReallyCoolMovez::AllocateNewMove()
 {
-	return FSavedMovePtr(new FSavedMove_ReallyCoolMovez());
+	if (FreeMovePoolSlots.Num() == 0)
+	{
+		LLM_SCOPE_MOVEMENTPREDICTION(SavedMoves);
+		++MovePoolOverflowCount;
+		return FSavedMovePtr(new FSavedMove_ReallyCoolMovez());
+	}
+
+	const int32 SlotIndex = FreeMovePoolSlots.Pop(false);
+	MovePoolHighWaterMark = FMath::Max(MovePoolHighWaterMark, MovePool.Num() - FreeMovePoolSlots.Num());
+
+	return FSavedMovePtr(&MovePool[SlotIndex], [this](FSavedMove_ReallyCoolMovez* Move) { ReleasePooledMove(Move); });
+}
+
+void FNetworkPredictionData_Client_ReallyCoolMovez::ReleasePooledMove(FSavedMove_ReallyCoolMovez* Move)
+{
+	const int32 SlotIndex = static_cast<int32>(Move - MovePool.GetData());
+	check(MovePool.IsValidIndex(SlotIndex));
+
+	FreeMovePoolSlots.Add(SlotIndex);
 }
 
 UReallyCoolMovementComponent::UReallyCoolMovementComponent(const FObjectInitializer& ObjectInitializer)
@@ -96,16 +252,70 @@ UReallyCoolMovementComponent::UReallyCoolMovementComponent(const FObjectInitiali
 {
 	DashSpeed = 1000.f;
 	DashDurationSeconds = 0.25f;
+	MaxDashSubstepTime = 1.f / 60.f;
+	NetworkMaxSmoothUpdateDistance = 92.f;
+	NetworkNoSmoothUpdateDistance = 140.f;
+	DashMaxSmoothNetUpdateDist = 250.f;
+	DashNoSmoothNetUpdateDist = 400.f;
+	DashPositionTolerance = 10.f;
+	DashVelocityTolerance = 100.f;
+	ClientErrorBlendDistance = 15.f;
+	ClientErrorBlendVelocity = 100.f;
+	ClientErrorBlendTime = 0.1f;
 	DashDir = FVector::ZeroVector;
+	PreDashMovementMode = MOVE_Walking;
+	DashYaw = 0;
+	ServerDashYaw = 0;
 	DashTimeRemaining = 0.f;
+	NumCorrectionsSent = 0;
+	NumDashCorrectionsSuppressed = 0;
+	ServerPositionErrorSum = 0.0;
+	NumServerPositionChecks = 0;
+	ServerMoveCycles = 0;
+	ServerMoveBufferJitterScale = 2.f;
+	MinServerMoveBufferDelay = 0.f;
+	MaxServerMoveBufferDelay = 0.1f;
+	PlayoutTimeStamp = 0.f;
+	NewestQueuedTimeStamp = 0.f;
+	ServerMoveArrivalJitter = 0.f;
+	LastServerMoveArrivalTime = 0.0;
+	LastServerMoveArrivalFrame = 0;
+	PreviousServerMoveArrivalTime = 0.0;
+	PreviousArrivalNewestTimeStamp = 0.f;
+	ServerMoveArrivalJitterBefore = 0.f;
+	LastPlayedArrivalFrame = 0;
+	LastPlayedFrame = 0;
+	bServerMovePlayoutStarted = false;
+	bServerMoveBufferUnderrun = false;
+	NumServerMoveBufferUnderruns = 0;
+	NumServerMovesRespaced = 0;
+	LastCheckedClientLocation = FVector::ZeroVector;
+	LastCheckedServerLocation = FVector::ZeroVector;
+	LastCheckedTimeStamp = 0.f;
+	PendingCorrectionBlend = FVector::ZeroVector;
+	CorrectionBlendTimeRemaining = 0.f;
+	CorrectionBlendApplied = FVector::ZeroVector;
+	SimulatedTickInterval = 0.f;
+	SimulatedTickTimeOwed = 0.f;
+	bSnapshotInterpolated = false;
+	bSnapshotDashing = false;
 }
 
 void UReallyCoolMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
 {
 	Super::UpdateFromCompressedFlags(Flags);
 
+	TRACE_MOVEMENTPREDICTION_UPDATE_FROM_COMPRESSED_FLAGS(this, Flags);
+
 	// Resets the movement component to the state when the move was made so we can resimulate
 	bWantsToDash = (Flags & FSavedMove_ReallyCoolMovez::FLAG_Custom_0) != 0;
+
+	// The client sent the direction along with this move, client replays already have it from PrepMoveFor
+	if (bWantsToDash && CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_Authority)
+	{
+		DashYaw = ServerDashYaw;
+		DashDir = DecompressDashDir(DashYaw);
+	}
 }
 
 FNetworkPredictionData_Client* UReallyCoolMovementComponent::GetPredictionData_Client() const
@@ -114,45 +324,955 @@ FNetworkPredictionData_Client* UReallyCoolMovementComponent::GetPredictionData_C
 
 	if (!ClientPredictionData)
 	{
+		LLM_SCOPE_MOVEMENTPREDICTION(PredictionData);
 		UReallyCoolMovementComponent* MutableThis = const_cast<UReallyCoolMovementComponent*>(this);
 
 		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_ReallyCoolMovez(*this);
-		MutableThis->ClientPredictionData->MaxSmoothNetUpdateDist = 92.f;
-		MutableThis->ClientPredictionData->NoSmoothNetUpdateDist = 140.f;
 	}
 
 	return ClientPredictionData;
 }
 
-void UReallyCoolMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+void UReallyCoolMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	// Set our dash movement
+	if (bWantsToDash)
+	{
+		bWantsToDash = false;
+		DashTimeRemaining = DashDurationSeconds;
+
+		// Dashing again mid-dash just restarts the timer
+		if (!IsDashing())
+		{
+			PreDashMovementMode = (MovementMode == MOVE_Custom || MovementMode == MOVE_None) ? MOVE_Falling : MovementMode.GetValue();
+			SetMovementMode(MOVE_Custom, CMOVE_Dash);
+		}
+
+		// Let everyone else know about it
+		if (CharacterOwner->GetLocalRole() == ROLE_Authority)
+		{
+			if (AMovementPredictionCharacter* Character = Cast<AMovementPredictionCharacter>(CharacterOwner))
+			{
+				Character->OnMovementDashStarted(DashDir);
+			}
+		}
+	}
+}
+
+float UReallyCoolMovementComponent::GetMaxSpeed() const
 {
-	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+	return IsDashing() ? DashSpeed : Super::GetMaxSpeed();
+}
 
-	if (!CharacterOwner)
+bool UReallyCoolMovementComponent::IsDashing() const
+{
+	return (MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_Dash) || bSnapshotDashing;
+}
+
+void UReallyCoolMovementComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == CMOVE_Dash)
 	{
+		PhysDash(deltaTime, Iterations);
 		return;
 	}
 
-	// Set our dash movement
-	if (bWantsToDash)
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+void UReallyCoolMovementComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+
+	// Something else (a correction, a teleport) took us out of the dash
+	if (PreviousMovementMode == MOVE_Custom && PreviousCustomMode == CMOVE_Dash && !IsDashing())
 	{
-		DashTimeRemaining = DashDurationSeconds;
-		bWantsToDash = false;
+		DashTimeRemaining = 0.f;
+	}
+}
+
+void UReallyCoolMovementComponent::PhysDash(float deltaTime, int32 Iterations)
+{
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	float RemainingTime = deltaTime;
+	while (RemainingTime >= MIN_TICK_TIME && DashTimeRemaining > 0.f && Iterations < MaxSimulationIterations && CharacterOwner)
+	{
+		Iterations++;
+
+		// Never step past the end of the dash, so a combined move covers the same distance as the moves it replaced
+		const float TimeTick = FMath::Min3(RemainingTime, DashTimeRemaining, MaxDashSubstepTime);
+		RemainingTime -= TimeTick;
+		DashTimeRemaining -= TimeTick;
+
+		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+		const FVector Delta = DashDir * DashSpeed * TimeTick;
+
+		// One sweep per substep, plus a slide if we hit something
+		FHitResult Hit(1.f);
+		SafeMoveUpdatedComponent(Delta, UpdatedComponent->GetComponentQuat(), true, Hit);
+
+		if (Hit.IsValidBlockingHit())
+		{
+			HandleImpact(Hit, TimeTick, Delta);
+			SlideAlongSurface(Delta, 1.f - Hit.Time, Hit.Normal, Hit, true);
+		}
+
+		// Report what actually happened, sliding along a wall slows us down
+		if (!bJustTeleported)
+		{
+			Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / TimeTick;
+		}
+
+		TRACE_MOVEMENTPREDICTION_DASH_STEP(this, TimeTick, DashTimeRemaining, Hit.IsValidBlockingHit());
+	}
+
+	if (DashTimeRemaining <= 0.f)
+	{
+		EndDash();
+		StartNewPhysics(RemainingTime, Iterations);
+	}
+}
+
+void UReallyCoolMovementComponent::EndDash()
+{
+	DashTimeRemaining = 0.f;
+	SetMovementMode(PreDashMovementMode);
+
+	// Don't carry dash speed into walking, it'd just skid
+	Velocity = Velocity.GetClampedToMaxSize(GetMaxSpeed());
+
+	if (CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_Authority)
+	{
+		if (AMovementPredictionCharacter* Character = Cast<AMovementPredictionCharacter>(CharacterOwner))
+		{
+			Character->OnMovementDashEnded();
+		}
+	}
+}
+
+void UReallyCoolMovementComponent::CallServerMove(const FSavedMove_Character* NewMove, const FSavedMove_Character* OldMove)
+{
+	FNetworkPredictionData_Client_ReallyCoolMovez* ClientData = static_cast<FNetworkPredictionData_Client_ReallyCoolMovez*>(GetPredictionData_Client());
+	++ClientData->NumServerMovesSent;
+
+	INC_DWORD_STAT(STAT_MovementPrediction_ServerMovesSent);
+	CSV_CUSTOM_STAT(MovementPrediction, ServerMovesSent, 1, ECsvCustomStatOp::Accumulate);
+
+	// Find whichever move we're about to send that starts a dash
+	const FSavedMove_ReallyCoolMovez* DashMove = nullptr;
+
+	const FSavedMove_Character* const SentMoves[] = { OldMove, ClientData->PendingMove.Get(), NewMove };
+	for (const FSavedMove_Character* SentMove : SentMoves)
+	{
+		if (SentMove && static_cast<const FSavedMove_ReallyCoolMovez*>(SentMove)->SavedState.bWantsToDash)
+		{
+			DashMove = static_cast<const FSavedMove_ReallyCoolMovez*>(SentMove);
+		}
+	}
+
+	if (MoveRecorder)
+	{
+		if (ClientData->PendingMove.IsValid())
+		{
+			MoveRecorder->RecordMove(*static_cast<const FSavedMove_ReallyCoolMovez*>(ClientData->PendingMove.Get()));
+		}
+		MoveRecorder->RecordMove(*static_cast<const FSavedMove_ReallyCoolMovez*>(NewMove));
+	}
+
+	// Unreliable and called right before the ServerMove, so the direction goes out in the same packet and is processed first
+	if (DashMove)
+	{
+		if (AMovementPredictionCharacter* Character = Cast<AMovementPredictionCharacter>(CharacterOwner))
+		{
+			Character->ServerRPC_SetDashYaw(DashMove->SavedState.DashYaw);
+		}
+	}
+
+	Super::CallServerMove(NewMove, OldMove);
+}
+
+void UReallyCoolMovementComponent::StartSimulatedDash(const FVector& DashDirection, float ElapsedSeconds)
+{
+	DashYaw = CompressDashDir(DashDirection);
+	DashDir = DecompressDashDir(DashYaw);
+	DashTimeRemaining = DashDurationSeconds - ElapsedSeconds;
+	bWantsToDash = false;
+
+	// SimulateMovement extrapolates the rest, get it going right away rather than waiting on the next movement update
+	Velocity = DashDir * DashSpeed;
+}
+
+void UReallyCoolMovementComponent::SendClientAdjustment()
+{
+	if (HasPredictionData_Server())
+	{
+		const FNetworkPredictionData_Server_Character* ServerData = GetPredictionData_Server_Character();
+		if (ServerData->PendingAdjustment.TimeStamp > 0.f && !ServerData->PendingAdjustment.bAckGoodMove)
+		{
+			++NumCorrectionsSent;
+			TRACE_MOVEMENTPREDICTION_SERVER_CORRECTION(this, ServerData->PendingAdjustment.TimeStamp, FVector::Dist(LastCheckedServerLocation, LastCheckedClientLocation));
+		}
+	}
+
+	Super::SendClientAdjustment();
+}
+
+void UReallyCoolMovementComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	// Throttled by the significance manager. The mesh still eases toward the capsule every frame, and each simulation step
+	// is smoothed over the frames until the next one like a net update, so far away characters don't visibly step.
+	if (SimulatedTickInterval > 0.f && CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_SimulatedProxy && UpdatedComponent &&
+		NetworkSmoothingMode == ENetworkSmoothingMode::Exponential)
+	{
+		SimulatedTickTimeOwed += DeltaTime;
+		if (SimulatedTickTimeOwed < SimulatedTickInterval)
+		{
+			SmoothClientPosition(DeltaTime);
+			return;
+		}
+
+		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+		const FQuat OldRotation = UpdatedComponent->GetComponentQuat();
+		const float StepTime = SimulatedTickTimeOwed;
+		SimulatedTickTimeOwed = 0.f;
+
+		Super::TickComponent(StepTime, TickType, ThisTickFunction);
+
+		SmoothCorrection(OldLocation, OldRotation, UpdatedComponent->GetComponentLocation(), UpdatedComponent->GetComponentQuat());
+		return;
+	}
+	SimulatedTickTimeOwed = 0.f;
+
+	// Arrived after this frame's batch ran
+	if (BatchedServerMoves.Num() > 0)
+	{
+		ProcessBatchedServerMoves();
+	}
+
+	if (QueuedServerMoves.Num() > 0 || bServerMovePlayoutStarted)
+	{
+		if (ShouldBufferServerMoves())
+		{
+			PlayServerMoves(DeltaTime);
+		}
+		else
+		{
+			// Turned off, or the client took over its own movement
+			FlushServerMoves();
+			bServerMovePlayoutStarted = false;
+		}
+	}
+
+	// Walk off what's left of small corrections, swept so it can't push us into anything
+	if (CorrectionBlendTimeRemaining > 0.f && UpdatedComponent)
+	{
+		const FVector Step = PendingCorrectionBlend * FMath::Min(DeltaTime / CorrectionBlendTimeRemaining, 1.f);
+		CorrectionBlendTimeRemaining -= DeltaTime;
+		PendingCorrectionBlend -= Step;
+
+		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+		FHitResult Hit(1.f);
+		SafeMoveUpdatedComponent(Step, UpdatedComponent->GetComponentQuat(), true, Hit);
+		CorrectionBlendApplied += UpdatedComponent->GetComponentLocation() - OldLocation;
+		if (Hit.bBlockingHit || CorrectionBlendTimeRemaining <= 0.f)
+		{
+			PendingCorrectionBlend = FVector::ZeroVector;
+			CorrectionBlendTimeRemaining = 0.f;
+		}
+	}
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// Moves came in through the net driver earlier this frame
+	if (ServerMoveCycles > 0)
+	{
+		const float ServerMoveMs = FPlatformTime::ToMilliseconds(ServerMoveCycles);
+		CSV_CUSTOM_STAT(MovementPrediction, ServerMoveMsTotal, ServerMoveMs, ECsvCustomStatOp::Accumulate);
+		CSV_CUSTOM_STAT(MovementPrediction, ServerMoveMsMaxConnection, ServerMoveMs, ECsvCustomStatOp::Max);
+		ServerMoveCycles = 0;
+	}
+
+	if (CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy && ClientPredictionData)
+	{
+		const int32 NumPendingMoves = GetPredictionData_Client_Character()->SavedMoves.Num();
+		INC_DWORD_STAT_BY(STAT_MovementPrediction_SavedMovesPending, NumPendingMoves);
+		CSV_CUSTOM_STAT(MovementPrediction, SavedMovesPending, NumPendingMoves, ECsvCustomStatOp::Set);
+	}
+}
+
+void UReallyCoolMovementComponent::ServerMove_Implementation(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	const bool bBufferMove = ShouldBufferServerMoves();
+	if (bBufferMove || ShouldBatchServerMoves())
+	{
+		FQueuedServerMove Move;
+		Move.TimeStamp = TimeStamp;
+		Move.Accel = InAccel;
+		Move.ClientLoc = ClientLoc;
+		Move.ClientMovementBase = ClientMovementBase;
+		Move.ClientBaseBoneName = ClientBaseBoneName;
+		Move.View = View;
+		Move.CompressedMoveFlags = CompressedMoveFlags;
+		Move.ClientRoll = ClientRoll;
+		Move.ClientMovementMode = ClientMovementMode;
+		Move.bOldMove = false;
+		if (bBufferMove)
+		{
+			QueueServerMove(Move);
+		}
+		else
+		{
+			BatchServerMove(Move);
+		}
+		return;
+	}
+
+	ProcessServerMove(TimeStamp, InAccel, ClientLoc, CompressedMoveFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+}
+
+void UReallyCoolMovementComponent::ServerMoveOld_Implementation(float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags)
+{
+	const bool bBufferMove = ShouldBufferServerMoves();
+	if (bBufferMove || ShouldBatchServerMoves())
+	{
+		FQueuedServerMove Move;
+		Move.TimeStamp = OldTimeStamp;
+		Move.Accel = OldAccel;
+		Move.View = 0;
+		Move.CompressedMoveFlags = OldMoveFlags;
+		Move.ClientRoll = 0;
+		Move.ClientMovementMode = 0;
+		Move.bOldMove = true;
+		if (bBufferMove)
+		{
+			QueueServerMove(Move);
+		}
+		else
+		{
+			BatchServerMove(Move);
+		}
+		return;
+	}
+
+	ProcessServerMoveOld(OldTimeStamp, OldAccel, OldMoveFlags);
+}
+
+void UReallyCoolMovementComponent::ProcessServerMove(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_ServerProcessMoves);
+	const uint32 StartCycles = FPlatformTime::Cycles();
+
+	Super::ServerMove_Implementation(TimeStamp, InAccel, ClientLoc, CompressedMoveFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+
+	ServerMoveCycles += FPlatformTime::Cycles() - StartCycles;
+}
+
+void UReallyCoolMovementComponent::ProcessServerMoveOld(float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_ServerProcessMoves);
+	const uint32 StartCycles = FPlatformTime::Cycles();
+
+	Super::ServerMoveOld_Implementation(OldTimeStamp, OldAccel, OldMoveFlags);
+
+	ServerMoveCycles += FPlatformTime::Cycles() - StartCycles;
+}
+
+bool UReallyCoolMovementComponent::ShouldBufferServerMoves() const
+{
+	return CVarServerMoveBuffer.GetValueOnGameThread() != 0 && CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_Authority && !CharacterOwner->IsLocallyControlled();
+}
+
+bool UReallyCoolMovementComponent::ShouldBatchServerMoves() const
+{
+	return UMovementPredictionServerMoveBatch::IsEnabled() && CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_Authority && !CharacterOwner->IsLocallyControlled();
+}
+
+void UReallyCoolMovementComponent::BatchServerMove(const FQueuedServerMove& InMove)
+{
+	LLM_SCOPE_MOVEMENTPREDICTION(PredictionData);
+	FQueuedServerMove& Move = BatchedServerMoves.Add_GetRef(InMove);
+	Move.DashYaw = ServerDashYaw;
+	Move.ArrivalFrame = GFrameCounter;
+
+	if (BatchedServerMoves.Num() == 1)
+	{
+		if (UMovementPredictionServerMoveBatch* ServerMoveBatch = GetWorld()->GetSubsystem<UMovementPredictionServerMoveBatch>())
+		{
+			ServerMoveBatch->AddMovement(this);
+		}
+	}
+}
+
+bool UReallyCoolMovementComponent::GetServerMoveBatchBounds(FBox& OutBounds) const
+{
+	OutBounds = FBox(ForceInit);
+	if (!HasValidData())
+	{
+		return false;
+	}
+
+	float Radius, HalfHeight;
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(Radius, HalfHeight);
+	const FVector Extent(Radius, Radius, HalfHeight);
+
+	bool bCanPrecompute = true;
+	OutBounds += FBox::BuildAABB(UpdatedComponent->GetComponentLocation(), Extent);
+	for (const FQueuedServerMove& Move : BatchedServerMoves)
+	{
+		if (Move.bOldMove || Move.ClientLoc == DualMovePendingClientLoc)
+		{
+			continue;
+		}
+
+		// ClientLoc is relative to the base, which can move during the batch
+		if (MovementBaseUtility::UseRelativeLocation(Move.ClientMovementBase.Get()))
+		{
+			bCanPrecompute = false;
+			continue;
+		}
+
+		OutBounds += FBox::BuildAABB(Move.ClientLoc, Extent);
+	}
+
+	// Floor checks reach down a step below the capsule
+	OutBounds.Min.Z -= MaxStepHeight + MAX_FLOOR_DIST;
+	return bCanPrecompute;
+}
+
+void UReallyCoolMovementComponent::PrecomputeServerMoveFloors()
+{
+	PrecomputedFloors.Reset();
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	float Radius, HalfHeight;
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(Radius, HalfHeight);
+
+	// What FindFloor asks for after a walking move, every other floor check doesn't match and does its own query
+	const float FloorDistance = FMath::Max(MAX_FLOOR_DIST, MaxStepHeight + MAX_FLOOR_DIST + KINDA_SMALL_NUMBER);
+
+	for (const FQueuedServerMove& Move : BatchedServerMoves)
+	{
+		TEnumAsByte<EMovementMode> ClientMode(MOVE_None);
+		TEnumAsByte<EMovementMode> ClientGroundMode(MOVE_None);
+		uint8 ClientCustomMode(0);
+		UnpackNetworkMovementMode(Move.ClientMovementMode, ClientMode, ClientCustomMode, ClientGroundMode);
+		if (Move.bOldMove || Move.ClientLoc == DualMovePendingClientLoc || ClientMode != MOVE_Walking || MovementBaseUtility::UseRelativeLocation(Move.ClientMovementBase.Get()))
+		{
+			continue;
+		}
+
+		FPrecomputedFloor& PrecomputedFloor = PrecomputedFloors.AddDefaulted_GetRef();
+		PrecomputedFloor.CapsuleLocation = Move.ClientLoc;
+		PrecomputedFloor.LineDistance = FloorDistance;
+		PrecomputedFloor.SweepDistance = FloorDistance;
+		PrecomputedFloor.SweepRadius = Radius;
+		Super::ComputeFloorDist(Move.ClientLoc, FloorDistance, FloorDistance, PrecomputedFloor.Floor, Radius, nullptr);
+
+		// Anything that can move could be somewhere else by the time we get there
+		const UPrimitiveComponent* FloorComponent = PrecomputedFloor.Floor.HitResult.Component.Get();
+		if (FloorComponent && FloorComponent->Mobility == EComponentMobility::Movable)
+		{
+			PrecomputedFloors.Pop(false);
+		}
+	}
+}
+
+FBox UReallyCoolMovementComponent::ProcessBatchedServerMoves()
+{
+	FBox Moved(ForceInit);
+	if (UpdatedComponent)
+	{
+		Moved += UpdatedComponent->Bounds.GetBox();
+	}
+
+	for (int32 MoveIndex = 0; MoveIndex < BatchedServerMoves.Num(); ++MoveIndex)
+	{
+		ProcessQueuedServerMove(BatchedServerMoves[MoveIndex]);
+		if (UpdatedComponent)
+		{
+			Moved += UpdatedComponent->Bounds.GetBox();
+		}
+	}
+
+	BatchedServerMoves.Reset();
+	PrecomputedFloors.Reset();
+	return Moved;
+}
+
+void UReallyCoolMovementComponent::ComputeFloorDist(const FVector& CapsuleLocation, float LineDistance, float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius, const FHitResult* DownwardSweepResult) const
+{
+	if (!DownwardSweepResult)
+	{
+		for (const FPrecomputedFloor& PrecomputedFloor : PrecomputedFloors)
+		{
+			if (PrecomputedFloor.LineDistance == LineDistance && PrecomputedFloor.SweepDistance == SweepDistance && PrecomputedFloor.SweepRadius == SweepRadius &&
+				FVector::PointsAreNear(CapsuleLocation, PrecomputedFloor.CapsuleLocation, PrecomputedFloorTolerance))
+			{
+				// Carry the rounding of ClientLoc over to the floor distance, so floor height adjustment sees where we really are
+				const float HeightAbove = CapsuleLocation.Z - PrecomputedFloor.CapsuleLocation.Z;
+				OutFloorResult = PrecomputedFloor.Floor;
+				if (OutFloorResult.bBlockingHit)
+				{
+					OutFloorResult.FloorDist += HeightAbove;
+					if (OutFloorResult.bLineTrace)
+					{
+						OutFloorResult.LineDist += HeightAbove;
+					}
+				}
+
+				INC_DWORD_STAT(STAT_MovementPrediction_PrecomputedFloorsUsed);
+				CSV_CUSTOM_STAT(MovementPrediction, PrecomputedFloorsUsed, 1, ECsvCustomStatOp::Accumulate);
+				return;
+			}
+		}
+	}
+
+	Super::ComputeFloorDist(CapsuleLocation, LineDistance, SweepDistance, OutFloorResult, SweepRadius, DownwardSweepResult);
+}
+
+void UReallyCoolMovementComponent::QueueServerMove(const FQueuedServerMove& InMove)
+{
+	LLM_SCOPE_MOVEMENTPREDICTION(PredictionData);
+	FQueuedServerMove& Move = QueuedServerMoves.Add_GetRef(InMove);
+	Move.DashYaw = ServerDashYaw;
+	Move.ArrivalFrame = GFrameCounter;
+
+	if (Move.bOldMove)
+	{
+		return;
+	}
+
+	// Client time stamps were reset, nothing queued before lines up with the new ones
+	if (bServerMovePlayoutStarted && Move.TimeStamp < NewestQueuedTimeStamp - 1.f)
+	{
+		const FQueuedServerMove ResetMove = QueuedServerMoves.Pop(false);
+		FlushServerMoves();
+		bServerMovePlayoutStarted = false;
+		QueuedServerMoves.Add(ResetMove);
+	}
+
+	// Moves are made at an even rate of client time, anything on top of that is the network bunching them up (RFC 3550 style jitter).
+	// Sampled once per arrival against its newest move, both halves of a ServerMoveDual come in together and would otherwise
+	// always look a move apart.
+	if (Move.ArrivalFrame != LastServerMoveArrivalFrame)
+	{
+		LastServerMoveArrivalFrame = Move.ArrivalFrame;
+		PreviousServerMoveArrivalTime = LastServerMoveArrivalTime;
+		PreviousArrivalNewestTimeStamp = NewestQueuedTimeStamp;
+		ServerMoveArrivalJitterBefore = ServerMoveArrivalJitter;
+		LastServerMoveArrivalTime = FPlatformTime::Seconds();
+	}
+
+	NewestQueuedTimeStamp = bServerMovePlayoutStarted ? FMath::Max(NewestQueuedTimeStamp, Move.TimeStamp) : Move.TimeStamp;
+	if (bServerMovePlayoutStarted)
+	{
+		const float Spread = float(LastServerMoveArrivalTime - PreviousServerMoveArrivalTime) - (NewestQueuedTimeStamp - PreviousArrivalNewestTimeStamp);
+		ServerMoveArrivalJitter = ServerMoveArrivalJitterBefore + (FMath::Abs(Spread) - ServerMoveArrivalJitterBefore) / 16.f;
+	}
+
+	bServerMoveBufferUnderrun = false;
+}
+
+void UReallyCoolMovementComponent::PlayServerMoves(float DeltaTime)
+{
+	const float TargetDelay = FMath::Clamp(ServerMoveArrivalJitter * ServerMoveBufferJitterScale, MinServerMoveBufferDelay, MaxServerMoveBufferDelay);
+
+	if (!bServerMovePlayoutStarted)
+	{
+		if (QueuedServerMoves.Num() == 0)
+		{
+			return;
+		}
+
+		bServerMovePlayoutStarted = true;
+		NewestQueuedTimeStamp = QueuedServerMoves.Last().TimeStamp;
+		PlayoutTimeStamp = NewestQueuedTimeStamp - TargetDelay;
+	}
+	else
+	{
+		// Drift back toward the target when the jitter settles rather than jumping, never fall further behind than the max
+		const float Delay = NewestQueuedTimeStamp - PlayoutTimeStamp;
+		const float CatchUp = Delay > TargetDelay + DeltaTime ? 1.1f : 1.f;
+		PlayoutTimeStamp = FMath::Max(PlayoutTimeStamp + DeltaTime * CatchUp, NewestQueuedTimeStamp - MaxServerMoveBufferDelay);
+	}
+
+	// Caught up with the client, wait where the newest move left off
+	if (PlayoutTimeStamp > NewestQueuedTimeStamp)
+	{
+		if (!bServerMoveBufferUnderrun)
+		{
+			bServerMoveBufferUnderrun = true;
+			++NumServerMoveBufferUnderruns;
+			INC_DWORD_STAT(STAT_MovementPrediction_ServerMoveBufferUnderruns);
+			CSV_CUSTOM_STAT(MovementPrediction, ServerMoveBufferUnderruns, 1, ECsvCustomStatOp::Accumulate);
+		}
+		PlayoutTimeStamp = NewestQueuedTimeStamp;
+	}
+
+	int32 NumPlayed = 0;
+	while (NumPlayed < QueuedServerMoves.Num() && QueuedServerMoves[NumPlayed].TimeStamp <= PlayoutTimeStamp)
+	{
+		ProcessQueuedServerMove(QueuedServerMoves[NumPlayed]);
+		++NumPlayed;
+	}
+	QueuedServerMoves.RemoveAt(0, NumPlayed, false);
+
+	INC_DWORD_STAT_BY(STAT_MovementPrediction_ServerMoveBufferDepth, QueuedServerMoves.Num());
+	CSV_CUSTOM_STAT(MovementPrediction, ServerMoveBufferDelayMs, GetServerMoveBufferDelay() * 1000.f, ECsvCustomStatOp::Max);
+}
+
+void UReallyCoolMovementComponent::FlushServerMoves()
+{
+	// Moves played from here can't queue again, they go straight to ProcessServerMove
+	TArray<FQueuedServerMove> Moves = MoveTemp(QueuedServerMoves);
+	for (const FQueuedServerMove& Move : Moves)
+	{
+		ProcessQueuedServerMove(Move);
+	}
+}
+
+void UReallyCoolMovementComponent::ProcessQueuedServerMove(const FQueuedServerMove& Move)
+{
+	// Bunched up on arrival but spread over frames by the buffer
+	if (Move.ArrivalFrame == LastPlayedArrivalFrame && GFrameCounter != LastPlayedFrame)
+	{
+		++NumServerMovesRespaced;
+		INC_DWORD_STAT(STAT_MovementPrediction_ServerMovesRespaced);
+		CSV_CUSTOM_STAT(MovementPrediction, ServerMovesRespaced, 1, ECsvCustomStatOp::Accumulate);
+	}
+	LastPlayedArrivalFrame = Move.ArrivalFrame;
+	LastPlayedFrame = GFrameCounter;
+
+	ServerDashYaw = Move.DashYaw;
+
+	if (Move.bOldMove)
+	{
+		ProcessServerMoveOld(Move.TimeStamp, Move.Accel, Move.CompressedMoveFlags);
+	}
+	else
+	{
+		ProcessServerMove(Move.TimeStamp, Move.Accel, Move.ClientLoc, Move.CompressedMoveFlags, Move.ClientRoll, Move.View, Move.ClientMovementBase.Get(), Move.ClientBaseBoneName, Move.ClientMovementMode);
+	}
+}
+
+void UReallyCoolMovementComponent::ClientAckGoodMove_Implementation(float TimeStamp)
+{
+	SampleMoveRoundTrip(TimeStamp);
+
+	Super::ClientAckGoodMove_Implementation(TimeStamp);
+}
+
+void UReallyCoolMovementComponent::ClientAdjustPosition_Implementation(float TimeStamp, FVector NewLoc, FVector NewVel, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode)
+{
+	SampleMoveRoundTrip(TimeStamp);
+
+	FNetworkPredictionData_Client_ReallyCoolMovez* ClientData = static_cast<FNetworkPredictionData_Client_ReallyCoolMovez*>(GetPredictionData_Client());
+
+	// Look at the move being corrected before the base class acks it away
+	bool bDashMispredicted = false;
+	const FSavedMove_ReallyCoolMovez* CorrectedMove = nullptr;
+	const int32 MoveIndex = ClientData->GetSavedMoveIndex(TimeStamp);
+	if (MoveIndex != INDEX_NONE)
+	{
+		CorrectedMove = static_cast<const FSavedMove_ReallyCoolMovez*>(ClientData->SavedMoves[MoveIndex].Get());
+		bDashMispredicted = CorrectedMove->SavedState.bWantsToDash || CorrectedMove->SavedState.DashTimeRemaining > 0.f;
+
+		if (!bBaseRelativePosition)
+		{
+			ClientData->LastCorrectionError = FVector::Dist(NewLoc, CorrectedMove->SavedLocation);
+		}
+	}
+
+	TEnumAsByte<EMovementMode> NetMovementMode(MOVE_None);
+	TEnumAsByte<EMovementMode> NetGroundMode(MOVE_None);
+	uint8 NetCustomMode(0);
+	UnpackNetworkMovementMode(ServerMovementMode, NetMovementMode, NetCustomMode, NetGroundMode);
+	bDashMispredicted |= NetMovementMode == MOVE_Custom && NetCustomMode == CMOVE_Dash;
+
+	++ClientData->NumCorrectionsReceived;
+	INC_DWORD_STAT(STAT_MovementPrediction_CorrectionsReceived);
+	CSV_CUSTOM_STAT(MovementPrediction, CorrectionsReceived, 1, ECsvCustomStatOp::Accumulate);
+
+	if (bDashMispredicted)
+	{
+		++ClientData->NumDashMispredictions;
+		INC_DWORD_STAT(STAT_MovementPrediction_DashMispredictions);
+		CSV_CUSTOM_STAT(MovementPrediction, DashMispredictions, 1, ECsvCustomStatOp::Accumulate);
+	}
+
+	// A few units off in the same mode on the same base - shift over a few frames instead of replaying every pending move.
+	// The moves after it were made from the old location, so the error carries over to where we are now. Moves already in
+	// flight get corrected by the same error, so count what's been blended since the move was made as already fixed.
+	const FVector BlendedLocation = CorrectedMove ? CorrectedMove->SavedLocation + CorrectionBlendApplied + PendingCorrectionBlend - CorrectedMove->SavedCorrectionBlendApplied : FVector::ZeroVector;
+	if (CVarSoftCorrections.GetValueOnGameThread() != 0 && CorrectedMove && !bBaseRelativePosition && (!bHasBase || NewBase == GetMovementBase()) &&
+		CorrectedMove->EndPackedMovementMode == ServerMovementMode &&
+		FVector::DistSquared(NewLoc, BlendedLocation) <= FMath::Square(ClientErrorBlendDistance) &&
+		FVector::DistSquared(NewVel, CorrectedMove->SavedVelocity) <= FMath::Square(ClientErrorBlendVelocity))
+	{
+		PendingCorrectionBlend += NewLoc - BlendedLocation;
+		CorrectionBlendTimeRemaining = ClientErrorBlendTime;
+		ClientData->AckMove(MoveIndex, *this);
+
+		++ClientData->NumCorrectionsBlended;
+		INC_DWORD_STAT(STAT_MovementPrediction_CorrectionsBlended);
+		CSV_CUSTOM_STAT(MovementPrediction, CorrectionsBlended, 1, ECsvCustomStatOp::Accumulate);
+		return;
+	}
+
+	// A full correction puts us exactly where the server says, anything left of a blend would only push us off it again
+	PendingCorrectionBlend = FVector::ZeroVector;
+	CorrectionBlendTimeRemaining = 0.f;
+
+	Super::ClientAdjustPosition_Implementation(TimeStamp, NewLoc, NewVel, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition, ServerMovementMode);
+
+	// The moves left get replayed from the corrected location, so none of the blending before now applies to them
+	for (const FSavedMovePtr& SavedMove : ClientData->SavedMoves)
+	{
+		static_cast<FSavedMove_ReallyCoolMovez*>(SavedMove.Get())->SavedCorrectionBlendApplied = CorrectionBlendApplied;
+	}
+}
+
+bool UReallyCoolMovementComponent::ClientUpdatePositionAfterServerUpdate()
+{
+	SCOPE_CYCLE_COUNTER(STAT_MovementPrediction_ClientReplay);
+	CSV_SCOPED_TIMING_STAT(MovementPrediction, ClientReplay);
+
+	FNetworkPredictionData_Client_ReallyCoolMovez* ClientData = static_cast<FNetworkPredictionData_Client_ReallyCoolMovez*>(GetPredictionData_Client());
+	if (!ClientData->bUpdatePosition)
+	{
+		return Super::ClientUpdatePositionAfterServerUpdate();
+	}
+
+	INC_DWORD_STAT_BY(STAT_MovementPrediction_MovesReplayed, ClientData->SavedMoves.Num());
+	CSV_CUSTOM_STAT(MovementPrediction, MovesReplayed, ClientData->SavedMoves.Num(), ECsvCustomStatOp::Accumulate);
+
+	const int32 NumMovesReplayed = ClientData->SavedMoves.Num();
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const bool bResult = Super::ClientUpdatePositionAfterServerUpdate();
+	const uint64 EndCycles = FPlatformTime::Cycles64();
+	ClientData->ClientReplayCycles += EndCycles - StartCycles;
+	TRACE_MOVEMENTPREDICTION_CLIENT_REPLAY(this, StartCycles, EndCycles, NumMovesReplayed);
+
+	return bResult;
+}
+
+bool UReallyCoolMovementComponent::ServerExceedsAllowablePositionError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	const bool bExceeds = Super::ServerExceedsAllowablePositionError(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+
+	// Only moves that were simulated and checked, the engine leaves out rejected time stamps and ServerMoveDual's placeholder
+	const FVector ServerLocation = UpdatedComponent->GetComponentLocation();
+	ServerPositionErrorSum += FVector::Dist(ServerLocation, ClientWorldLocation);
+	++NumServerPositionChecks;
+
+	const FVector ClientDelta = ClientWorldLocation - LastCheckedClientLocation;
+	const FVector ServerDelta = ServerLocation - LastCheckedServerLocation;
+	LastCheckedClientLocation = ClientWorldLocation;
+	LastCheckedServerLocation = ServerLocation;
+
+	// Not every move gets checked, the deltas cover every move since the last one that was. Falls back to this move's
+	// time on the first check and when the client's time stamps reset.
+	const float CheckedSeconds = (LastCheckedTimeStamp > 0.f && ClientTimeStamp > LastCheckedTimeStamp) ? ClientTimeStamp - LastCheckedTimeStamp : DeltaTime;
+	LastCheckedTimeStamp = ClientTimeStamp;
+
+	// Only dashes get the extra room, they cover ten times the ground of a walking move in the same time
+	if (!bExceeds || CVarSoftCorrections.GetValueOnGameThread() == 0 || !(IsDashing() || DashTimeRemaining > 0.f) || DeltaTime <= 0.f)
+	{
+		return bExceeds;
 	}
 
-	// Update dash
-	if (DashTimeRemaining > 0.f)
+	// Disagreeing about the mode or standing on something that moves always gets corrected
+	if (PackNetworkMovementMode() != ClientMovementMode || (ClientMovementBase && ClientMovementBase->Mobility == EComponentMobility::Movable))
 	{
-		GetCharacterOwner()->AddActorWorldOffset(DashDir * DashSpeed * DeltaSeconds, true);
+		return true;
+	}
+
+	if (FVector::DistSquared(ServerLocation, ClientWorldLocation) > FMath::Square(DashPositionTolerance) ||
+		(ClientDelta - ServerDelta).SizeSquared() > FMath::Square(DashVelocityTolerance * CheckedSeconds))
+	{
+		return true;
+	}
+
+	++NumDashCorrectionsSuppressed;
+	INC_DWORD_STAT(STAT_MovementPrediction_DashCorrectionsSuppressed);
+	CSV_CUSTOM_STAT(MovementPrediction, DashCorrectionsSuppressed, 1, ECsvCustomStatOp::Accumulate);
+	return false;
+}
 
-		//Launch(DashDir * DashSpeed);
-		DashTimeRemaining -= DeltaSeconds;
+void UReallyCoolMovementComponent::StartMoveRecording(const FString& Filename)
+{
+	MoveRecorder = MakeUnique<FMovementStreamRecorder>(Filename);
+	UE_LOG(LogReallyCoolMovement, Log, TEXT("Recording moves to %s"), *Filename);
+}
+
+bool UReallyCoolMovementComponent::StopMoveRecording()
+{
+	if (!MoveRecorder)
+	{
+		return false;
 	}
+
+	const bool bSaved = MoveRecorder->Finish();
+	UE_LOG(LogReallyCoolMovement, Log, TEXT("Recorded %d moves (%s)"), MoveRecorder->GetNumMoves(), bSaved ? TEXT("saved") : TEXT("failed to save"));
+
+	MoveRecorder.Reset();
+	return bSaved;
+}
+
+void UReallyCoolMovementComponent::ResetForReplay(const FRecordedMoveStream& Stream)
+{
+	// There's no controller when replaying offline
+	bRunPhysicsWithNoController = true;
+
+	UpdatedComponent->SetWorldLocationAndRotation(Stream.StartLocation, Stream.StartRotation, false, nullptr, ETeleportType::TeleportPhysics);
+	Velocity = Stream.StartVelocity;
+	ApplyNetworkMovementMode(Stream.StartPackedMovementMode);
+
+	// Same as PrepMoveFor for the move the stream starts with, the dash input comes from each move's flags
+	FPredictedFields::Restore(Stream.StartState, *this);
+	bWantsToDash = false;
+	DashDir = DecompressDashDir(DashYaw);
+}
+
+void UReallyCoolMovementComponent::ReplayRecordedMove(const FRecordedMove& Move)
+{
+	ServerDashYaw = Move.DashYaw;
+	MoveAutonomous(Move.TimeStamp, Move.DeltaTime, Move.CompressedFlags, Move.Acceleration);
+}
+
+void UReallyCoolMovementComponent::SimulateMovement(float DeltaTime)
+{
+	// Snapshot interpolation has already put us where the server was
+	if (bSnapshotInterpolated)
+	{
+		return;
+	}
+
+	// We know where a dash is going and when it ends, so keep it going between net updates and stop on time
+	// instead of running on with the last replicated velocity until the next update tells us otherwise
+	if (CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_SimulatedProxy && DashTimeRemaining > 0.f)
+	{
+		Velocity = DashDir * DashSpeed;
+		DashTimeRemaining -= DeltaTime;
+
+		if (DashTimeRemaining <= 0.f)
+		{
+			DashTimeRemaining = 0.f;
+			Velocity = Velocity.GetClampedToMaxSize(MaxWalkSpeed);
+		}
+	}
+
+	Super::SimulateMovement(DeltaTime);
+}
+
+void UReallyCoolMovementComponent::SmoothCorrection(const FVector& OldLocation, const FQuat& OldRotation, const FVector& NewLocation, const FQuat& NewRotation)
+{
+	// Dashers cover a lot of ground between updates, smooth over bigger errors rather than teleporting
+	if (FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character())
+	{
+		const bool bDashing = IsDashing() || DashTimeRemaining > 0.f;
+		ClientData->MaxSmoothNetUpdateDist = bDashing ? DashMaxSmoothNetUpdateDist : NetworkMaxSmoothUpdateDistance;
+		ClientData->NoSmoothNetUpdateDist = bDashing ? DashNoSmoothNetUpdateDist : NetworkNoSmoothUpdateDistance;
+	}
+
+	Super::SmoothCorrection(OldLocation, OldRotation, NewLocation, NewRotation);
+}
+
+void UReallyCoolMovementComponent::SetSnapshotInterpolated(bool bInSnapshotInterpolated)
+{
+	bSnapshotInterpolated = bInSnapshotInterpolated;
+	if (!bSnapshotInterpolated)
+	{
+		bSnapshotDashing = false;
+	}
+}
+
+void UReallyCoolMovementComponent::SetSnapshotState(const FVector& InVelocity, bool bInDashing)
+{
+	Velocity = InVelocity;
+	bSnapshotDashing = bInDashing;
+}
+
+void UReallyCoolMovementComponent::SetServerDashYaw(uint16 InDashYaw)
+{
+	ServerDashYaw = InDashYaw;
+}
+
+bool UReallyCoolMovementComponent::GetClientTimeStampAge(float ClientTimeStamp, float& OutAge) const
+{
+	const FNetworkPredictionData_Server_Character* ServerData = HasPredictionData_Server() ? GetPredictionData_Server_Character() : nullptr;
+	if (!ServerData)
+	{
+		return false;
+	}
+
+	// Client time stamps reset every MinTimeBetweenTimeStampResets, anything straddling a reset is treated as now
+	OutAge = ServerData->CurrentClientTimeStamp - ClientTimeStamp;
+	if (FMath::Abs(OutAge) > MinTimeBetweenTimeStampResets * 0.5f)
+	{
+		OutAge = 0.f;
+	}
+	return true;
+}
+
+float UReallyCoolMovementComponent::GetSmoothedRoundTripTime() const
+{
+	return HasPredictionData_Client() ? static_cast<const FNetworkPredictionData_Client_ReallyCoolMovez*>(GetPredictionData_Client())->SmoothedRoundTripTime : 0.f;
+}
+
+float UReallyCoolMovementComponent::GetRoundTripTimeVariation() const
+{
+	return HasPredictionData_Client() ? static_cast<const FNetworkPredictionData_Client_ReallyCoolMovez*>(GetPredictionData_Client())->RoundTripTimeVariation : 0.f;
+}
+
+void UReallyCoolMovementComponent::SampleMoveRoundTrip(float TimeStamp)
+{
+	FNetworkPredictionData_Client_ReallyCoolMovez* ClientData = static_cast<FNetworkPredictionData_Client_ReallyCoolMovez*>(GetPredictionData_Client());
+
+	// The move was stamped on the same clock we're stamping moves with now, so there's no clock offset to guess at
+	const float RoundTripTime = ClientData->CurrentTimeStamp - TimeStamp;
+	if (RoundTripTime < 0.f || RoundTripTime > MinTimeBetweenTimeStampResets * 0.5f)
+	{
+		return;
+	}
+
+	if (ClientData->NumRoundTripSamples++ == 0)
+	{
+		ClientData->SmoothedRoundTripTime = RoundTripTime;
+		ClientData->RoundTripTimeVariation = RoundTripTime * 0.5f;
+		return;
+	}
+
+	ClientData->RoundTripTimeVariation += (FMath::Abs(ClientData->SmoothedRoundTripTime - RoundTripTime) - ClientData->RoundTripTimeVariation) * 0.25f;
+	ClientData->SmoothedRoundTripTime += (RoundTripTime - ClientData->SmoothedRoundTripTime) * 0.125f;
 }
 
 void UReallyCoolMovementComponent::StartDash(const FVector& DashDirection)
 {
-	DashDir = DashDirection;
+	// Dash with the quantized direction so the client, server and any replays all move the same way
+	DashYaw = CompressDashDir(DashDirection);
+	DashDir = DecompressDashDir(DashYaw);
 	bWantsToDash = true;
 }
 
+uint16 UReallyCoolMovementComponent::CompressDashDir(const FVector& DashDirection)
+{
+	return FRotator::CompressAxisToShort(DashDirection.Rotation().Yaw);
+}
+
+FVector UReallyCoolMovementComponent::DecompressDashDir(uint16 DashYaw)
+{
+	float Sin, Cos;
+	FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(FRotator::DecompressAxisFromShort(DashYaw)));
+	return FVector(Cos, Sin, 0.f);
+}
+
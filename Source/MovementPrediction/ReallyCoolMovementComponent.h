@@ -4,11 +4,22 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "MovementStreamRecorder.h"
+#include "SavedMoveFields.h"
 #include "ReallyCoolMovementComponent.generated.h"
 
 class ACharacter;
 class FNetworkPredictionData_Client_Character;
 
+/** Our modes for when MovementMode is MOVE_Custom */
+UENUM(BlueprintType)
+enum ECoolCustomMovementMode
+{
+	CMOVE_None		UMETA(Hidden),
+	CMOVE_Dash		UMETA(DisplayName = "Dash"),
+	CMOVE_MAX		UMETA(Hidden),
+};
+
 class FSavedMove_ReallyCoolMovez : public FSavedMove_Character
 {
 public:
@@ -26,6 +37,9 @@ public:
 	/** Checks whether or not this move can be combined with another */
 	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* Character, float MaxDelta) const override;
 
+	/** Combines this move with the pending one, restoring the dash to where the pending move started it */
+	virtual void CombineWith(const FSavedMove_Character* OldMove, ACharacter* InCharacter, APlayerController* PC, const FVector& OldStartLocation) override;
+
 	/** Sets the move before sending to the server */
 	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, const FVector& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
 	
@@ -34,25 +48,106 @@ public:
 
 	// End FSavedMove_Character Interface
 
-	// Dash input flag - used to re-trigger the ability if a correction forces us to resimulate
-	uint8 bSavedWantsToDash : 1;
+	// Every predicted field, saved, restored and compared as UReallyCoolMovementComponent::FPredictedFields says
+	FReallyCoolSavedState SavedState;
 
-	// Dash time remaining
-	float SavedDashTimeRemaining;
-
-	// Desired dash direction
-	FVector SavedDashDir;
+	// UReallyCoolMovementComponent::CorrectionBlendApplied when the move was made, soft corrections to it count what's blended since
+	FVector SavedCorrectionBlendApplied;
 };
 
 class FNetworkPredictionData_Client_ReallyCoolMovez : public FNetworkPredictionData_Client_Character
 {
 public:
 	FNetworkPredictionData_Client_ReallyCoolMovez(const UCharacterMovementComponent& ClientMovement);
+	virtual ~FNetworkPredictionData_Client_ReallyCoolMovez();
 
 	typedef FNetworkPredictionData_Client_Character Super;
 
-	/** Allocates a new copy of the saved move */
+	/** Hands out a move from the preallocated pool, only falling back to the heap if the pool is exhausted */
 	virtual FSavedMovePtr AllocateNewMove() override;
+
+	/** Number of moves the pool was sized for */
+	int32 GetMovePoolCapacity() const { return MovePool.Num(); }
+
+	/** Most pooled moves that have been handed out at the same time */
+	int32 GetMovePoolHighWaterMark() const { return MovePoolHighWaterMark; }
+
+	/** Number of moves that had to be heap allocated because the pool was empty */
+	int32 GetMovePoolOverflowCount() const { return MovePoolOverflowCount; }
+
+	/** Bytes owned by the pool */
+	SIZE_T GetMovePoolAllocatedSize() const { return MovePool.GetAllocatedSize() + FreeMovePoolSlots.GetAllocatedSize(); }
+
+	// Moves folded into a later move instead of being sent on their own, and how many of those were mid-dash
+	uint32 NumCombinedMoves;
+	uint32 NumCombinedDashMoves;
+
+	// Calls to CallServerMove, i.e. ServerMove RPCs sent
+	uint32 NumServerMovesSent;
+
+	// Corrections from the server, how many of those hit a dash, and how far off the last one was
+	uint32 NumCorrectionsReceived;
+	uint32 NumDashMispredictions;
+	float LastCorrectionError;
+
+	// Corrections small enough to blend out without replaying, see mp.SoftCorrections
+	uint32 NumCorrectionsBlended;
+
+	// Time spent replaying saved moves after corrections
+	uint64 ClientReplayCycles;
+
+	// Round trip time from sending a move to hearing back about it, on the movement clock, smoothed like TCP's SRTT/RTTVAR
+	float SmoothedRoundTripTime;
+	float RoundTripTimeVariation;
+	uint32 NumRoundTripSamples;
+
+private:
+
+	/** Deleter for pooled moves - puts the slot back instead of freeing it */
+	void ReleasePooledMove(FSavedMove_ReallyCoolMovez* Move);
+
+	// Contiguous storage for every move we hand out, never resized after construction
+	TArray<FSavedMove_ReallyCoolMovez> MovePool;
+
+	// Indices into MovePool that aren't owned by any FSavedMovePtr
+	TArray<int32> FreeMovePoolSlots;
+
+	int32 MovePoolHighWaterMark;
+	int32 MovePoolOverflowCount;
+};
+
+/** A ServerMove or ServerMoveOld the server is holding back, for the server move buffer or the server move batch */
+struct FQueuedServerMove
+{
+	float TimeStamp;
+	FVector_NetQuantize10 Accel;
+	FVector_NetQuantize100 ClientLoc;
+	TWeakObjectPtr<UPrimitiveComponent> ClientMovementBase;
+	FName ClientBaseBoneName;
+	uint32 View;
+
+	// ServerDashYaw when the move arrived, a later dash can change it before this one plays out
+	uint16 DashYaw;
+
+	uint8 CompressedMoveFlags;
+	uint8 ClientRoll;
+	uint8 ClientMovementMode;
+	uint8 bOldMove : 1;
+
+	// Server frame the move arrived in
+	uint64 ArrivalFrame;
+};
+
+/** A floor the server move batch looked up ahead of the move that needs it, see UMovementPredictionServerMoveBatch */
+struct FPrecomputedFloor
+{
+	// The arguments ComputeFloorDist was called with
+	FVector CapsuleLocation;
+	float LineDistance;
+	float SweepDistance;
+	float SweepRadius;
+
+	FFindFloorResult Floor;
 };
 
 /**
@@ -70,14 +165,151 @@ public:
 	// Begin UCharacterMovementComponent Interface
 	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
 	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
-	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
+	virtual void CallServerMove(const FSavedMove_Character* NewMove, const FSavedMove_Character* OldMove) override;
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+	virtual float GetMaxSpeed() const override;
+	virtual void SendClientAdjustment() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void ServerMove_Implementation(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+	virtual void ServerMoveOld_Implementation(float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags) override;
+	virtual void ClientAckGoodMove_Implementation(float TimeStamp) override;
+	virtual void ClientAdjustPosition_Implementation(float TimeStamp, FVector NewLoc, FVector NewVel, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode) override;
+	virtual bool ClientUpdatePositionAfterServerUpdate() override;
+	virtual bool ServerExceedsAllowablePositionError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+	virtual void SimulateMovement(float DeltaTime) override;
+	virtual void SmoothCorrection(const FVector& OldLocation, const FQuat& OldRotation, const FVector& NewLocation, const FQuat& NewRotation) override;
+	virtual void ComputeFloorDist(const FVector& CapsuleLocation, float LineDistance, float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius, const FHitResult* DownwardSweepResult = nullptr) const override;
 	// End UCharacterMovementComponent Interface
 
 	/** Tells the component to start a dash */
 	void StartDash(const FVector& DashDirection);
 
+	/** Simulated proxies only - resumes a dash that's been running on the server for ElapsedSeconds */
+	void StartSimulatedDash(const FVector& DashDirection, float ElapsedSeconds);
+
+	/** Simulated proxies only - runs the simulation every TickInterval instead of every frame, 0 for every frame */
+	void SetSimulatedTickInterval(float TickInterval) { SimulatedTickInterval = TickInterval; }
+
+	/** Simulated proxies only - stops simulating, UMovementPredictionSnapshots places us instead */
+	void SetSnapshotInterpolated(bool bInSnapshotInterpolated);
+	bool IsSnapshotInterpolated() const { return bSnapshotInterpolated; }
+
+	/** Simulated proxies only - the velocity and dash state interpolated from the snapshots, for animation */
+	void SetSnapshotState(const FVector& InVelocity, bool bInDashing);
+
+	/** Server only - direction for the next move that has the dash flag set */
+	void SetServerDashYaw(uint16 InDashYaw);
+
+	/**
+	 * Server only - how long before the newest move we've simulated the client stamped ClientTimeStamp, negative if we haven't
+	 * got that far yet. Same clock as ServerMove, 0 when the two straddle a time stamp reset. Returns false without server prediction data.
+	 */
+	bool GetClientTimeStampAge(float ClientTimeStamp, float& OutAge) const;
+
+	/** Owning client only - seconds from sending a move to the server's ack or correction for it, 0 until the first one comes back */
+	float GetSmoothedRoundTripTime() const;
+
+	/** Owning client only - how much GetSmoothedRoundTripTime moves around, in seconds */
+	float GetRoundTripTimeVariation() const;
+
+	/** Dash directions are 2D, so we only keep (and send) a compressed yaw */
+	static uint16 CompressDashDir(const FVector& DashDirection);
+	static FVector DecompressDashDir(uint16 DashYaw);
+
+	/** Whether we're in the dash movement mode */
+	bool IsDashing() const;
+
+	/** Starts recording the moves we send to the server */
+	void StartMoveRecording(const FString& Filename);
+
+	/** Stops recording and writes the file, returns false if it couldn't be written */
+	bool StopMoveRecording();
+
+	/** Puts us back in the state a recorded stream started from, with nothing networked */
+	void ResetForReplay(const FRecordedMoveStream& Stream);
+
+	/** Simulates a recorded move the same way the server would have */
+	void ReplayRecordedMove(const FRecordedMove& Move);
+
+	/** Server only - corrections sent to the owning client */
+	uint32 GetNumCorrectionsSent() const { return NumCorrectionsSent; }
+
+	/** Server only - dash moves past the engine's error limit but within the dash tolerances, acked instead of corrected */
+	uint32 GetNumDashCorrectionsSuppressed() const { return NumDashCorrectionsSuppressed; }
+
+	/** Server only - summed distance between where the client said each checked move ended and where we ended it */
+	double GetServerPositionErrorSum() const { return ServerPositionErrorSum; }
+	uint32 GetNumServerPositionChecks() const { return NumServerPositionChecks; }
+
+	/** Server only - how far behind the newest move from the client the server move buffer is playing, 0 when it's off */
+	float GetServerMoveBufferDelay() const { return bServerMovePlayoutStarted ? FMath::Max(NewestQueuedTimeStamp - PlayoutTimeStamp, 0.f) : 0.f; }
+
+	/** Server only - times the server move buffer ran dry and had to wait for the client */
+	uint32 GetNumServerMoveBufferUnderruns() const { return NumServerMoveBufferUnderruns; }
+
+	/** Server only - moves that arrived bunched up with the one before but were played out on a later frame */
+	uint32 GetNumServerMovesRespaced() const { return NumServerMovesRespaced; }
+
+	/**
+	 * Server only - box around everywhere this frame's batched moves say the capsule went and the floor checks under it.
+	 * Returns false if the floors can't be looked up ahead, e.g. a move is relative to a moving base.
+	 */
+	bool GetServerMoveBatchBounds(FBox& OutBounds) const;
+
+	/**
+	 * Server only - looks up the floor under where the client said each batched walking move ended, for ComputeFloorDist to reuse.
+	 * Only does scene queries and only writes our own floors, so it's safe on a worker thread as long as nothing is moving.
+	 */
+	void PrecomputeServerMoveFloors();
+
+	int32 GetNumPrecomputedFloors() const { return PrecomputedFloors.Num(); }
+
+	/** Server only - something moved through where our floors were looked up */
+	void DiscardPrecomputedFloors() { PrecomputedFloors.Reset(); }
+
+	/** Server only - processes this frame's batched moves, returns a box around everywhere they took the capsule */
+	FBox ProcessBatchedServerMoves();
+
 protected:
 
+	// Begin UCharacterMovementComponent Interface
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+	// End UCharacterMovementComponent Interface
+
+	/** Straight line dash, substepped so the result doesn't depend on frame rate */
+	void PhysDash(float deltaTime, int32 Iterations);
+
+	/** Goes back to the movement mode we were in before the dash */
+	void EndDash();
+
+	/** Whether ServerMoves from our client go through the server move buffer, see mp.ServerMoveBuffer */
+	bool ShouldBufferServerMoves() const;
+
+	/** Whether ServerMoves from our client wait for the server move batch, see mp.BatchServerMoves */
+	bool ShouldBatchServerMoves() const;
+
+	/** Holds a move back for the server move batch */
+	void BatchServerMove(const FQueuedServerMove& Move);
+
+	/** Holds a move back for PlayServerMoves, keeping track of how unevenly moves are arriving */
+	void QueueServerMove(const FQueuedServerMove& Move);
+
+	/** Plays out the queued moves the playout clock has reached, advancing it by DeltaTime */
+	void PlayServerMoves(float DeltaTime);
+
+	/** Plays out every queued move right away */
+	void FlushServerMoves();
+
+	void ProcessQueuedServerMove(const FQueuedServerMove& Move);
+
+	// What ServerMove_Implementation does with a move, buffered or not
+	void ProcessServerMove(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode);
+	void ProcessServerMoveOld(float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags);
+
+	/** Owning client only - folds the round trip of the move stamped TimeStamp into the smoothed RTT */
+	void SampleMoveRoundTrip(float TimeStamp);
+
 	// Speed of the dash
 	UPROPERTY(EditDefaultsOnly, Category = "Dash")
 	float DashSpeed;
@@ -86,8 +318,131 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Dash")
 	float DashDurationSeconds;
 
-	// Variables we need - movement prediction will touch these
-	uint8 bWantsToDash : 1;
+	// Longest time step a single dash sweep covers, lower is more accurate against thin walls at low frame rates
+	UPROPERTY(EditDefaultsOnly, Category = "Dash", meta = (ClampMin = "0.001", UIMin = "0.001"))
+	float MaxDashSubstepTime;
+
+	// NetworkMaxSmoothUpdateDistance and NetworkNoSmoothUpdateDistance while dashing - a dash covers those in about a tenth of a second
+	UPROPERTY(EditDefaultsOnly, Category = "Network Smoothing")
+	float DashMaxSmoothNetUpdateDist;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Network Smoothing")
+	float DashNoSmoothNetUpdateDist;
+
+	// With mp.SoftCorrections, how far the client can end a dash move from the server before it's corrected
+	UPROPERTY(EditDefaultsOnly, Category = "Network Corrections")
+	float DashPositionTolerance;
+
+	// Same for how far apart the client's and server's average velocity over the move can be
+	UPROPERTY(EditDefaultsOnly, Category = "Network Corrections")
+	float DashVelocityTolerance;
+
+	// With mp.SoftCorrections, corrections the client gets that are at most this far off are blended out instead of replayed
+	UPROPERTY(EditDefaultsOnly, Category = "Network Corrections")
+	float ClientErrorBlendDistance;
+
+	// As long as the corrected velocity is also at most this far off
+	UPROPERTY(EditDefaultsOnly, Category = "Network Corrections")
+	float ClientErrorBlendVelocity;
+
+	// Seconds a blended correction takes to play out
+	UPROPERTY(EditDefaultsOnly, Category = "Network Corrections", meta = (ClampMin = "0.001", UIMin = "0.001"))
+	float ClientErrorBlendTime;
+
+	// The server move buffer plays moves this many times the measured arrival jitter behind the newest one
+	UPROPERTY(EditDefaultsOnly, Category = "Server Move Buffer")
+	float ServerMoveBufferJitterScale;
+
+	// Bounds on that delay, in seconds - every second of it is latency added to the owning client's corrections
+	UPROPERTY(EditDefaultsOnly, Category = "Server Move Buffer")
+	float MinServerMoveBufferDelay;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Server Move Buffer")
+	float MaxServerMoveBufferDelay;
+
+	// Variables we need - movement prediction will touch these, anything added here goes in FPredictedFields
+	uint8 bWantsToDash;
 	float DashTimeRemaining;
+	uint16 DashYaw;
 	FVector DashDir;
+	TEnumAsByte<EMovementMode> PreDashMovementMode;
+
+	// Last dash direction the owning client sent us
+	uint16 ServerDashYaw;
+
+	uint32 NumCorrectionsSent;
+	uint32 NumDashCorrectionsSuppressed;
+	double ServerPositionErrorSum;
+	uint32 NumServerPositionChecks;
+
+	// Time spent on this connection's ServerMoves since our last tick
+	uint32 ServerMoveCycles;
+
+	// Server move buffer, oldest move first
+	TArray<FQueuedServerMove> QueuedServerMoves;
+
+	// Client time stamp the buffer has played out to, and the newest one the client has sent
+	float PlayoutTimeStamp;
+	float NewestQueuedTimeStamp;
+
+	// Smoothed difference between how far apart moves arrive and how far apart the client made them, in seconds
+	float ServerMoveArrivalJitter;
+	double LastServerMoveArrivalTime;
+
+	// The frame the last moves arrived in, when and with what newest time stamp the ones before them arrived, and the
+	// jitter before their sample. Moves arriving together are one sample, redone as each one comes in.
+	uint64 LastServerMoveArrivalFrame;
+	double PreviousServerMoveArrivalTime;
+	float PreviousArrivalNewestTimeStamp;
+	float ServerMoveArrivalJitterBefore;
+
+	// Frames the last played out move arrived and was played in
+	uint64 LastPlayedArrivalFrame;
+	uint64 LastPlayedFrame;
+
+	uint8 bServerMovePlayoutStarted : 1;
+	uint8 bServerMoveBufferUnderrun : 1;
+
+	uint32 NumServerMoveBufferUnderruns;
+	uint32 NumServerMovesRespaced;
+
+	// Moves waiting for this frame's server move batch, and the floors it looked up for them
+	TArray<FQueuedServerMove> BatchedServerMoves;
+	TArray<FPrecomputedFloor> PrecomputedFloors;
+
+	// Where the client and the server ended the last move we checked and its time stamp, for the dash velocity tolerance
+	FVector LastCheckedClientLocation;
+	FVector LastCheckedServerLocation;
+	float LastCheckedTimeStamp;
+
+	// Part of a blended correction still to be applied, how long to spread it over, and how far blending has moved us in all
+	FVector PendingCorrectionBlend;
+	float CorrectionBlendTimeRemaining;
+	FVector CorrectionBlendApplied;
+
+	// Set by the significance manager, and the time simulated proxies have put off simulating since their last step
+	float SimulatedTickInterval;
+	float SimulatedTickTimeOwed;
+
+	// Simulated proxies placed by snapshot interpolation rather than simulated, and whether the snapshots have us dashing
+	uint8 bSnapshotInterpolated : 1;
+	uint8 bSnapshotDashing : 1;
+
+	// Set while recording our moves with mp.RecordMoves
+	TUniquePtr<FMovementStreamRecorder> MoveRecorder;
+
+public:
+
+	/**
+	 * The predicted fields above, where FSavedMove_ReallyCoolMovez keeps each one and how it's treated. Saving, restoring,
+	 * combining and recording saved moves are all generated from this, so a new predicted field is one line here.
+	 */
+	typedef TSavedMoveFieldList<
+		SAVED_MOVE_FIELD(FReallyCoolSavedState, bWantsToDash, UReallyCoolMovementComponent, bWantsToDash, Equal, FromFlags),
+		// Only the dash phase has to match to combine. The time remaining counts down every frame, but CombineWith rewinds it to
+		// our start and the dash step is clamped to what's left, so one long move covers the same distance as two short ones.
+		SAVED_MOVE_FIELD(FReallyCoolSavedState, DashTimeRemaining, UReallyCoolMovementComponent, DashTimeRemaining, SamePhase, Restore),
+		SAVED_MOVE_FIELD(FReallyCoolSavedState, DashYaw, UReallyCoolMovementComponent, DashYaw, Equal, Restore),
+		SAVED_MOVE_FIELD(FReallyCoolSavedState, PreDashMovementMode, UReallyCoolMovementComponent, PreDashMovementMode, Any, Restore)
+	> FPredictedFields;
 };
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** What stops two saved moves with different values of a field from being combined into one */
+enum class ESavedMoveFieldCombine : uint8
+{
+	/** Only moves with the same value combine */
+	Equal,
+
+	/** Only moves that are both at zero or both above it combine, for timers CombineWith rewinds to the older move */
+	SamePhase,
+
+	/** Doesn't stop moves combining */
+	Any,
+};
+
+/** How a field gets back onto the component when a saved move is replayed */
+enum class ESavedMoveFieldReplay : uint8
+{
+	/** PrepMoveFor puts it back */
+	Restore,
+
+	/** It's input sent in the compressed flags, UpdateFromCompressedFlags puts it back */
+	FromFlags,
+};
+
+/**
+ * One predicted field - where a saved move keeps it (StateMember of its state struct), the component member it's saved
+ * from and restored to, and how it affects combining. Everything is known at compile time, so each operation inlines
+ * down to the same copy or compare a hand written one would be. Declare them with SAVED_MOVE_FIELD.
+ */
+template <typename StateType, typename StateFieldType, StateFieldType StateType::*StateMember,
+	typename ComponentType, typename ComponentFieldType, ComponentFieldType ComponentType::*ComponentMember,
+	ESavedMoveFieldCombine Combine, ESavedMoveFieldReplay Replay>
+struct TSavedMoveField
+{
+	static_assert(TIsPODType<StateFieldType>::Value, "Saved move state has to be plain data, it's copied and compared in bulk");
+
+	static FORCEINLINE void Save(StateType& State, const ComponentType& Component)
+	{
+		State.*StateMember = static_cast<StateFieldType>(Component.*ComponentMember);
+	}
+
+	static FORCEINLINE void Restore(const StateType& State, ComponentType& Component)
+	{
+		if (Replay == ESavedMoveFieldReplay::Restore)
+		{
+			Component.*ComponentMember = static_cast<ComponentFieldType>(State.*StateMember);
+		}
+	}
+
+	static FORCEINLINE bool CanCombine(const StateType& State, const StateType& NewState)
+	{
+		switch (Combine)
+		{
+		case ESavedMoveFieldCombine::Equal:
+			return State.*StateMember == NewState.*StateMember;
+		case ESavedMoveFieldCombine::SamePhase:
+			return (State.*StateMember > StateFieldType(0)) == (NewState.*StateMember > StateFieldType(0));
+		default:
+			return true;
+		}
+	}
+
+	static FORCEINLINE void Serialize(FArchive& Ar, StateType& State)
+	{
+		Ar << State.*StateMember;
+	}
+};
+
+/** Declares a TSavedMoveField, e.g. SAVED_MOVE_FIELD(FMyMoveState, Charge, UMyMovement, Charge, SamePhase, Restore) */
+#define SAVED_MOVE_FIELD(StateType, StateMember, ComponentType, ComponentMember, Combine, Replay) \
+	TSavedMoveField<StateType, decltype(StateType::StateMember), &StateType::StateMember, \
+		ComponentType, decltype(ComponentType::ComponentMember), &ComponentType::ComponentMember, \
+		ESavedMoveFieldCombine::Combine, ESavedMoveFieldReplay::Replay>
+
+/**
+ * Every predicted field of a movement component, in one list. Each operation runs over the whole list in declaration
+ * order, CanCombine stops at the first field that doesn't match.
+ */
+template <typename... FieldTypes>
+struct TSavedMoveFieldList
+{
+	/** Copies every field from the component into a saved move's state, for SetMoveFor */
+	template <typename StateType, typename ComponentType>
+	static FORCEINLINE void Save(StateType& State, const ComponentType& Component)
+	{
+		const int32 Unused[] = { 0, (FieldTypes::Save(State, Component), 0)... };
+		(void)Unused;
+	}
+
+	/** Copies the fields PrepMoveFor is responsible for back onto the component */
+	template <typename StateType, typename ComponentType>
+	static FORCEINLINE void Restore(const StateType& State, ComponentType& Component)
+	{
+		const int32 Unused[] = { 0, (FieldTypes::Restore(State, Component), 0)... };
+		(void)Unused;
+	}
+
+	template <typename StateType>
+	static FORCEINLINE bool CanCombine(const StateType& State, const StateType& NewState)
+	{
+		bool bCanCombine = true;
+		const int32 Unused[] = { 0, (bCanCombine = bCanCombine && FieldTypes::CanCombine(State, NewState), 0)... };
+		(void)Unused;
+		return bCanCombine;
+	}
+
+	/** Reads or writes every field in declaration order, the order is the format */
+	template <typename StateType>
+	static void Serialize(FArchive& Ar, StateType& State)
+	{
+		const int32 Unused[] = { 0, (FieldTypes::Serialize(Ar, State), 0)... };
+		(void)Unused;
+	}
+};
+
+/** What a FSavedMove_ReallyCoolMovez saves of the dash, see UReallyCoolMovementComponent::FPredictedFields */
+struct FReallyCoolSavedState
+{
+	// Dash time remaining
+	float DashTimeRemaining;
+
+	// Desired dash direction, as a compressed yaw (dashes are always 2D)
+	uint16 DashYaw;
+
+	// Movement mode to go back to when the dash ends
+	uint8 PreDashMovementMode;
+
+	// Dash input flag - used to re-trigger the ability if a correction forces us to resimulate
+	uint8 bWantsToDash;
+};
+
+// There can be a lot of these waiting for acks
+static_assert(sizeof(FReallyCoolSavedState) == 8, "FReallyCoolSavedState should stay packed");